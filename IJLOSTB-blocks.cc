@@ -1,89 +1,137 @@
 export module Blocks;
 
-import Block;
-import <vector>;
+import <array>;
+import <cstdint>;
 
-// I-Block:  IIII (horizontal line)
-export class IBlock : public Block {
-public:
-    IBlock(int startR = 6, int startC = 0)
-        : Block({Position{0, 0}, Position{0, 1}, Position{0, 2}, Position{0, 3}}, 
-                startR, startC, 'I') {}
-    
-    char getSymbol() const override { return 'I'; }
+
+export class Position {
+    public:
+    int row, col;
+};
+
+
+// One orientation of a shape, normalized so its bounding box starts at (0, 0)
+export struct Orientation {
+    std::array<Position, 4> cells;
+    int size;                               // number of used cells
+    int height, width;                      // bounding box
+    std::array<std::uint16_t, 4> rowMasks;  // bit c of rowMasks[r] = cell (r, c)
+    std::array<int, 4> colBottom;           // lowest used row in each column
+};
+
+
+// All four orientations of a shape; orient[k] is k clockwise turns from spawn
+export struct Shape {
+    char type;
+    std::array<Orientation, 4> orient;
 };
 
+
+// Shift cells so the bounding box starts at (0, 0) and fill in the
+// derived fields (size, height, width, row masks, column bottoms)
+constexpr Orientation normalized(Orientation o) {
+    o.height = o.width = 0;
+    o.rowMasks = {0, 0, 0, 0};
+    o.colBottom = {-1, -1, -1, -1};
+    if (o.size == 0) return o;
+
+    int minR = 9999, minC = 9999, maxR = -9999, maxC = -9999;
+    for (int i = 0; i < o.size; ++i) {
+        minR = o.cells[i].row < minR ? o.cells[i].row : minR;
+        minC = o.cells[i].col < minC ? o.cells[i].col : minC;
+        maxR = o.cells[i].row > maxR ? o.cells[i].row : maxR;
+        maxC = o.cells[i].col > maxC ? o.cells[i].col : maxC;
+    }
+
+    o.height = maxR - minR + 1;
+    o.width = maxC - minC + 1;
+    for (int i = 0; i < o.size; ++i) {
+        o.cells[i].row -= minR;
+        o.cells[i].col -= minC;
+        o.rowMasks[o.cells[i].row] |= static_cast<std::uint16_t>(1u << o.cells[i].col);
+        if (o.cells[i].row > o.colBottom[o.cells[i].col]) {
+            o.colBottom[o.cells[i].col] = o.cells[i].row;
+        }
+    }
+    return o;
+}
+
+// Quarter turn clockwise: (r, c) -> (c, -r), then renormalize
+constexpr Orientation turnedCW(const Orientation &o) {
+    Orientation t = o;
+    for (int i = 0; i < o.size; ++i) {
+        t.cells[i] = Position{o.cells[i].col, -o.cells[i].row};
+    }
+    return normalized(t);
+}
+
+constexpr Shape makeShape(char type, std::array<Position, 4> cells, int size = 4) {
+    Shape s{type, {}};
+    s.orient[0] = normalized(Orientation{cells, size, 0, 0, {}, {}});
+    for (int k = 1; k < 4; ++k) {
+        s.orient[k] = turnedCW(s.orient[k - 1]);
+    }
+    return s;
+}
+
+// I-Block:  IIII (horizontal line)
+export inline constexpr Shape IShape = makeShape('I', {{{0, 0}, {0, 1}, {0, 2}, {0, 3}}});
+
 // J-Block:  J
 //           JJJ
-export class JBlock : public Block {
-public:
-    JBlock(int startR = 6, int startC = 0)
-        : Block({Position{0, 0}, Position{1, 0}, Position{1, 1}, Position{1, 2}}, 
-                startR, startC, 'J') {}
-    
-    char getSymbol() const override { return 'J'; }
-};
+export inline constexpr Shape JShape = makeShape('J', {{{0, 0}, {1, 0}, {1, 1}, {1, 2}}});
 
 // L-Block:    L
 //           LLL
-export class LBlock : public Block {
-public:
-    LBlock(int startR = 6, int startC = 0)
-        : Block({Position{0, 2}, Position{1, 0}, Position{1, 1}, Position{1, 2}}, 
-                startR, startC, 'L') {}
-    
-    char getSymbol() const override { return 'L'; }
-};
+export inline constexpr Shape LShape = makeShape('L', {{{0, 2}, {1, 0}, {1, 1}, {1, 2}}});
 
 // O-Block:  OO
 //           OO
-export class OBlock : public Block {
-public:
-    OBlock(int startR = 6, int startC = 0)
-        : Block({Position{0, 0}, Position{0, 1}, Position{1, 0}, Position{1, 1}}, 
-                startR, startC, 'O') {}
-    
-    char getSymbol() const override { return 'O'; }
-};
+export inline constexpr Shape OShape = makeShape('O', {{{0, 0}, {0, 1}, {1, 0}, {1, 1}}});
 
 // S-Block:   SS
 //           SS
-export class SBlock : public Block {
-public:
-    SBlock(int startR = 6, int startC = 0)
-        : Block({Position{0, 1}, Position{0, 2}, Position{1, 0}, Position{1, 1}}, 
-                startR, startC, 'S') {}
-    
-    char getSymbol() const override { return 'S'; }
-};
+export inline constexpr Shape SShape = makeShape('S', {{{0, 1}, {0, 2}, {1, 0}, {1, 1}}});
 
 // Z-Block:  ZZ
 //            ZZ
-export class ZBlock : public Block {
-public:
-    ZBlock(int startR = 6, int startC = 0)
-        : Block({Position{0, 0}, Position{0, 1}, Position{1, 1}, Position{1, 2}}, 
-                startR, startC, 'Z') {}
-    
-    char getSymbol() const override { return 'Z'; }
-};
+export inline constexpr Shape ZShape = makeShape('Z', {{{0, 0}, {0, 1}, {1, 1}, {1, 2}}});
 
 // T-Block:  TTT
 //            T
-export class TBlock : public Block {
-public:
-    TBlock(int startR = 6, int startC = 0)
-        : Block({Position{0, 0}, Position{0, 1}, Position{0, 2}, Position{1, 1}}, 
-                startR, startC, 'T') {}
-    
-    char getSymbol() const override { return 'T'; }
-};
+export inline constexpr Shape TShape = makeShape('T', {{{0, 0}, {0, 1}, {0, 2}, {1, 1}}});
 
 // Star Block (1x1) for Level 4
-export class StarBlock : public Block {
-public:
-    StarBlock(int startR = 6, int startC = 5)  // Center column (column 5 of 11)
-        : Block({Position{0, 0}}, startR, startC, '*') {}
-    
-    char getSymbol() const override { return '*'; }
-};
+export inline constexpr Shape StarShape = makeShape('*', {{{0, 0}}}, 1);
+
+// Placeholder for "no block"
+export inline constexpr Shape NoShape = makeShape(' ', {}, 0);
+
+static_assert(IShape.orient[1].height == 4 && IShape.orient[1].width == 1);
+static_assert(TShape.orient[2].rowMasks[0] == 0b010 && TShape.orient[2].rowMasks[1] == 0b111);
+static_assert(TShape.orient[0].colBottom[0] == 0 && TShape.orient[0].colBottom[1] == 1);
+
+// One of the seven regular blocks (the star block is level-generated only)
+export constexpr bool isTetromino(char type) {
+    switch (type) {
+        case 'I': case 'J': case 'L': case 'O':
+        case 'S': case 'Z': case 'T':
+            return true;
+        default:
+            return false;
+    }
+}
+
+export constexpr const Shape &shapeFor(char type) {
+    switch (type) {
+        case 'I': return IShape;
+        case 'J': return JShape;
+        case 'L': return LShape;
+        case 'O': return OShape;
+        case 'S': return SShape;
+        case 'Z': return ZShape;
+        case 'T': return TShape;
+        case '*': return StarShape;
+        default:  return NoShape;
+    }
+}
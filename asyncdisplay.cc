@@ -0,0 +1,143 @@
+export module AsyncDisplay;
+
+import IDisplay;
+import <array>;
+import <atomic>;
+import <cstdint>;
+import <memory>;
+import <string>;
+import <thread>;
+
+using namespace std;
+
+// What the render thread draws: the latest frame and the latest message,
+// each numbered so the render thread can tell which of them are new
+struct Snapshot {
+    Frame frame;
+    uint64_t frameSeq = 0;    // 0 until the first frame
+    string message;
+    uint64_t messageSeq = 0;  // 0 until the first message
+};
+
+// Single-producer single-consumer mailbox holding only the newest snapshot.
+// Three buffers rotate between the producer (being written), the mailbox
+// (published, maybe not yet read) and the consumer (being drawn); handing
+// one over is a single atomic exchange, so neither side ever blocks the
+// other. Publishing over an unread snapshot simply replaces it.
+class SnapshotMailbox {
+    static constexpr uint32_t IndexMask = 3;
+    static constexpr uint32_t Fresh = 4;    // the mailbox holds an unread snapshot
+    static constexpr uint32_t Closed = 8;   // no more snapshots will be published
+
+    array<Snapshot, 3> slots;
+    atomic<uint32_t> state{1};  // index of the mailbox slot, plus flags
+    uint32_t back = 0;          // producer's slot
+    uint32_t front = 2;         // consumer's slot
+
+public:
+    // Producer: the slot to fill before publish()
+    Snapshot& draft() { return slots[back]; }
+
+    void publish() {
+        uint32_t prev = state.exchange(back | Fresh);
+        back = prev & IndexMask;
+        state.notify_one();
+    }
+
+    void close() {
+        state.fetch_or(Closed);
+        state.notify_one();
+    }
+
+    // Consumer: wait for the newest unread snapshot; nullptr once closed and
+    // everything published has been taken
+    const Snapshot* take() {
+        uint32_t s = state.load();
+        while (true) {
+            if (s & Fresh) {
+                if (state.compare_exchange_weak(s, front | (s & Closed))) break;
+                continue;
+            }
+            if (s & Closed) return nullptr;
+            state.wait(s);
+            s = state.load();
+        }
+        front = s & IndexMask;
+        return &slots[front];
+    }
+};
+
+// Runs another display on its own thread. The game thread only copies the
+// frame or message into the mailbox and returns; the render thread draws
+// whatever is newest, so frames (and the messages between them) that are
+// superseded before it gets to them are dropped. On destruction the newest
+// state is drawn before the thread stops.
+export class AsyncDisplay : public IDisplay {
+    unique_ptr<IDisplay> inner;
+    bool verbose;
+
+    // Game thread state, copied into each published snapshot
+    Frame lastFrame;
+    uint64_t frameSeq = 0;
+    string lastMessage;
+    uint64_t messageSeq = 0;
+
+    SnapshotMailbox mailbox;
+    thread worker;
+
+    void publish() {
+        if (frameSeq == 0) return;  // messages wait for the first frame
+        Snapshot& s = mailbox.draft();
+        if (s.frameSeq != frameSeq) {
+            s.frame = lastFrame;
+            s.frameSeq = frameSeq;
+        }
+        if (s.messageSeq != messageSeq) {
+            s.message = lastMessage;
+            s.messageSeq = messageSeq;
+        }
+        mailbox.publish();
+    }
+
+    void drawLoop() {
+        uint64_t drawnFrame = 0, drawnMessage = 0;
+        while (const Snapshot* s = mailbox.take()) {
+            if (s->messageSeq != drawnMessage) {
+                inner->message(s->message);
+                drawnMessage = s->messageSeq;
+            }
+            if (s->frameSeq != drawnFrame) {
+                inner->render(s->frame);
+                drawnFrame = s->frameSeq;
+            }
+        }
+    }
+
+public:
+    explicit AsyncDisplay(unique_ptr<IDisplay> display)
+        : inner{std::move(display)}, verbose{inner->wantsMessages()} {
+        worker = thread([this] { drawLoop(); });
+    }
+
+    ~AsyncDisplay() {
+        mailbox.close();
+        worker.join();
+    }
+
+    AsyncDisplay(const AsyncDisplay&) = delete;
+    AsyncDisplay& operator=(const AsyncDisplay&) = delete;
+
+    void message(const string& s) override {
+        lastMessage = s;
+        ++messageSeq;
+        publish();
+    }
+
+    void render(const Frame& frame) override {
+        lastFrame = frame;
+        ++frameSeq;
+        publish();
+    }
+
+    bool wantsMessages() const override { return verbose; }
+};
@@ -0,0 +1,247 @@
+// Microbenchmarks for the board, block, level, parser, text display and
+// snapshot file hot paths. Each benchmark prints one JSON object per line:
+//   {"name": ..., "ns_per_op": ..., "allocs_per_op": ..., "p50": ..., ...}
+// where p50/p90/p99 are per-op times (ns) over the timed samples.
+
+import Board;
+import Block;
+import Level;
+import LevelFactory;
+import Random;
+import CommandInterpreter;
+import Player;
+import IDisplay;
+import TextDisplay;
+import MatchState;
+import <iostream>;
+import <string>;
+import <vector>;
+import <algorithm>;
+import <chrono>;
+import <new>;
+import <cstdlib>;
+import <cstdio>;
+import <cstring>;
+
+using namespace std;
+
+// Global allocation counter (the benchmarks are single-threaded)
+static size_t allocCount = 0;
+
+void* operator new(size_t n) {
+    ++allocCount;
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Keeps results observable so loops are not optimized away
+static volatile long long sink = 0;
+static void keep(long long v) { sink = sink + v; }
+
+// Swallows everything written to it (stands in for /dev/null)
+struct NullBuffer : streambuf {
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+// Time `samples` batches of `ops` calls to body(i). setup() runs before
+// every batch, outside the timed region.
+template <typename Setup, typename Body>
+void bench(const string& name, int samples, int ops, Setup setup, Body body) {
+    vector<double> perOp;
+    perOp.reserve(samples);
+    double totalNs = 0;
+    size_t totalAllocs = 0;
+
+    for (int s = 0; s < samples; ++s) {
+        setup();
+        size_t allocsBefore = allocCount;
+        auto t0 = chrono::steady_clock::now();
+        for (int i = 0; i < ops; ++i) {
+            body(i);
+        }
+        auto t1 = chrono::steady_clock::now();
+        totalAllocs += allocCount - allocsBefore;
+
+        double ns = chrono::duration<double, nano>(t1 - t0).count();
+        totalNs += ns;
+        perOp.push_back(ns / ops);
+    }
+
+    sort(perOp.begin(), perOp.end());
+    auto pct = [&](double p) { return perOp[static_cast<size_t>(p * (perOp.size() - 1))]; };
+    double totalOps = static_cast<double>(samples) * ops;
+
+    cout << "{\"name\": \"" << name << "\""
+         << ", \"ns_per_op\": " << totalNs / totalOps
+         << ", \"allocs_per_op\": " << totalAllocs / totalOps
+         << ", \"p50\": " << pct(0.50)
+         << ", \"p90\": " << pct(0.90)
+         << ", \"p99\": " << pct(0.99)
+         << ", \"samples\": " << samples
+         << ", \"ops_per_sample\": " << ops << "}" << endl;
+}
+
+template <typename Body>
+void bench(const string& name, int samples, int ops, Body body) {
+    bench(name, samples, ops, [] {}, body);
+}
+
+// A board with random junk below row `top`
+static Board randomBoard(Rng& rng, int top, int density) {
+    Board b;
+    for (int r = top; r < b.numRows(); ++r) {
+        for (int c = 0; c < b.numCols(); ++c) {
+            if (rng.below(100) < density) b.setCell(r, c, 'X');
+        }
+    }
+    return b;
+}
+
+static void benchBoard() {
+    Rng rng(42);
+    const string types = "IJLOSZT";
+
+    vector<Board> boards;
+    for (int i = 0; i < 64; ++i) {
+        boards.push_back(randomBoard(rng, 8 + rng.below(8), 60));
+    }
+    vector<Block> blocks;
+    for (int i = 0; i < 1024; ++i) {
+        Block b = makeBlock(types[rng.below(7)]);
+        b.orientation = static_cast<uint8_t>(rng.below(4));
+        b.row = static_cast<int16_t>(rng.below(20));
+        b.col = static_cast<int16_t>(rng.below(11));
+        blocks.push_back(b);
+    }
+
+    bench("board.canPlace", 200, 4096, [&](int i) {
+        keep(boards[i & 63].canPlace(blocks[i & 1023]));
+    });
+
+    // k full rows at the bottom under random rubble, cleared in one call
+    for (int k = 1; k <= 4; ++k) {
+        Board base = randomBoard(rng, 10, 50);
+        for (int r = base.numRows() - k; r < base.numRows(); ++r) {
+            for (int c = 0; c < base.numCols(); ++c) base.setCell(r, c, 'X');
+        }
+        for (int r = 10; r < base.numRows() - k; ++r) base.setCell(r, 0, ' ');
+
+        vector<Board> work(256, base);
+        bench("board.clearFullRows." + to_string(k), 200, 256,
+              [&] { fill(work.begin(), work.end(), base); },
+              [&](int i) { keep(work[i].clearFullRows()); });
+    }
+}
+
+static void benchBlock() {
+    Block b = makeBlock('T');
+    bench("block.rotateCW", 200, 4096, [&](int) {
+        b.rotateCW();
+        keep(b.row);
+    });
+    bench("block.rotateCCW", 200, 4096, [&](int) {
+        b.rotateCCW();
+        keep(b.row);
+    });
+}
+
+static void benchLevels() {
+    Rng rng(7);
+    for (int level = 0; level <= 4; ++level) {
+        auto lvl = makeLevel(level, rng, "biquadris_sequence1.txt");
+        bench("level" + to_string(level) + ".nextBlock", 200, 4096, [&](int) {
+            keep(lvl->nextBlock().type);
+        });
+    }
+}
+
+static void benchParser() {
+    const vector<string> mix = {
+        "left", "right", "3right", "2left", "down", "drop", "clockwise",
+        "counterclockwise", "cw", "ri", "lef", "dr", "do", "2cl", "levelup",
+        "leveldown", "I", "T", "norandom biquadris_sequence1.txt", "random",
+        "10left", "sequence seq.txt", "bogus"
+    };
+    CommandInterpreter ci;
+    bench("interpreter.parseWithMultiplier", 200, 1024, [&](int i) {
+        keep(ci.parseWithMultiplier(mix[i % mix.size()]).repeat);
+    });
+    bench("interpreter.compile", 200, 1024, [&](int i) {
+        keep(ci.compile(mix[i % mix.size()]).repeat);
+    });
+}
+
+static void benchRender() {
+    Player p1(0, "biquadris_sequence1.txt");
+    Player p2(0, "biquadris_sequence2.txt");
+    p1.spawnInitialBlocks();
+    p2.spawnInitialBlocks();
+    Rng rng(3);
+    for (int r = 12; r < p1.getBoard().numRows(); ++r) {
+        for (int c = 0; c < p1.getBoard().numCols(); ++c) {
+            if (rng.below(2)) p1.getBoard().setCell(r, c, 'Z');
+            if (rng.below(2)) p2.getBoard().setCell(r, c, 'S');
+        }
+    }
+
+    // Output goes to a null buffer; cout is restored before the result
+    // line is printed
+    TextDisplay display;
+    Frame frame;
+    NullBuffer nullBuf;
+    streambuf* saved = cout.rdbuf();
+    bench("textdisplay.render", 100, 64, [&](int) {
+        cout.rdbuf(&nullBuf);
+        frame.capture(p1, p2);
+        display.render(frame);
+        cout.rdbuf(saved);
+    });
+}
+
+// Write a mid-match snapshot file and map it back; false (with a message)
+// if the mapped state is not exactly the one written
+static bool benchSnapshot() {
+    Player p1(0, "biquadris_sequence1.txt");
+    Player p2(0, "biquadris_sequence2.txt");
+    p1.spawnInitialBlocks();
+    p2.spawnInitialBlocks();
+    for (int i = 0; i < 30; ++i) {
+        for (Player* p : {&p1, &p2}) {
+            if (!p->canPlaceCurrentBlock()) continue;
+            p->getBoard().dropToBottom(*p->getCurrentBlock());
+            p->lockCurrentBlock();
+            p->spawnNextBlock();
+        }
+    }
+    MatchState s{};
+    p1.saveState(s.players[0]);
+    p2.saveState(s.players[1]);
+    s.hiScore = max(p1.getScore(), p2.getScore());
+    s.commandsExecuted = 80;
+
+    const string path = "bench-snapshot.bqms";
+    bool ok = true;
+    bench("matchstate.saveSnapshot", 20, 4, [&](int) {
+        ok = saveSnapshot(path, s) && ok;
+    });
+    bench("matchstate.openSnapshot", 100, 64, [&](int) {
+        SnapshotFile file;
+        ok = file.open(path) && memcmp(&file.state(), &s, sizeof s) == 0 && ok;
+    });
+    remove(path.c_str());
+    if (!ok) cerr << "bench: snapshot file did not round-trip" << endl;
+    return ok;
+}
+
+int main() {
+    benchBoard();
+    benchBlock();
+    benchLevels();
+    benchParser();
+    benchRender();
+    return benchSnapshot() ? 0 : 1;
+}
@@ -1,105 +1,91 @@
 export module Block;
 
-import <vector>;
-import <algorithm>;
-import <utility>;
+export import Blocks;
+import <array>;
+import <cstdint>;
+import <type_traits>;
 
 
-export class Position {
-    public:
-    int row, col;
+// Absolute cells of a block, held inline (a block has at most 4 cells)
+export class CellView {
+    std::array<Position, 4> cells{};
+    int count = 0;
+
+public:
+    void push(Position p) { cells[count++] = p; }
+    void clear() { count = 0; }
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const Position* begin() const { return cells.data(); }
+    const Position* end() const { return cells.data() + count; }
 };
 
 
+// A piece is a plain value: its type selects a constexpr Shape table in the
+// Blocks module, so copying, storing and spawning it never allocates.
 export class Block {
 public:
-    std::vector<Position> cells;  // to store LLLLLLL
-    int row, col; //top left position
-    char type;
-    int countCCW = 0;
-
-    Block(const std::vector<Position> &shape, int startR = 6, int startC = 0, char t = ' '):
-        cells{shape}, row{startR}, col{startC}, type{t} {}
-    
-    virtual ~Block(){}
+    char type = ' ';                   // ' ' means "no block"
+    std::uint8_t orientation = 0;      // clockwise quarter turns from spawn
+    std::int16_t row = 0, col = 0;     //top left position
 
-    virtual char getSymbol() const = 0;
+    bool empty() const { return type == ' '; }
+    char getSymbol() const { return type; }
 
     void moveDown() {++row;}
     void moveUp() {--row;}
     void moveLeft() {--col;}
     void moveRight() {++col;}
 
-    virtual void rotateCCW() {
-        for (auto &p : cells) {
-            int r = p.row, c = p.col;
-            p.row = c;
-            p.col = -r;
-        }
-        normalize();
-    }
+    // Rotations keep the lower-left corner of the bounding box in place, so
+    // rotating one way and then the other restores the exact position.
+    void rotateCCW() { turn(3); }
+    void rotateCW() { turn(1); }
 
-    virtual void rotateCW() {
-        int oldMinR=9999, oldMaxR=-9999, oldMinC=9999, oldMaxC=-9999;
-        for (auto &p : cells) {
-            oldMinR = std::min(oldMinR, p.row);
-            oldMaxR = std::max(oldMaxR, p.row);
-            oldMinC = std::min(oldMinC, p.col);
-            oldMaxC = std::max(oldMaxC, p.col);
-        }
+    const Orientation &current() const {
+        return shapeFor(type).orient[orientation];
+    }
 
-        for (auto &p : cells) {
-            int r = p.row, c = p.col;
-            p.row = c;
-            p.col = -r;
-        }
+    CellView getAbsoluteCells() const{
+        CellView ans;
+        const Orientation &o = current();
 
-        int newMinR=9999, newMaxR=-9999, newMinC=9999, newMaxC=-9999;
-        for (auto &p : cells) {
-            newMinR = std::min(newMinR, p.row);
-            newMaxR = std::max(newMaxR, p.row);
-            newMinC = std::min(newMinC, p.col);
-            newMaxC = std::max(newMaxC, p.col);
+        for (int i = 0; i < o.size; ++i){
+            ans.push(Position{row + o.cells[i].row, col + o.cells[i].col});
         }
 
-        int oldLLrow = row + oldMaxR;
-        int oldLLcol = col + oldMinC;
-
-        int newLRrow = row + newMaxR;
-        int newLRcol = col + newMaxC;
-
-        row += (oldLLrow - newLRrow);
-        col += (oldLLcol - newLRcol);
-
-        normalize();
+        return ans;
     }
 
+    // Occupancy of each shape row as a bitmask (bit c = column c of the shape).
+    // Returns the number of rows used.
+    int rowMasks(std::array<std::uint16_t, 4> &masks) const {
+        masks = current().rowMasks;
+        return current().height;
+    }
 
-    std::vector<Position> getAbsoluteCells() const{
-        std::vector<Position> ans;
 
-        for (auto &p : cells){
-            ans.emplace_back(Position{row + p.row, col +p.col});
-        }
+    private:
 
-        return ans;
+    void turn(int clockwiseTurns){
+        int oldHeight = current().height;
+        orientation = (orientation + clockwiseTurns) & 3;
+        row += oldHeight - current().height;
     }
+};
 
 
-    private:
+static_assert(std::is_trivially_copyable_v<Block> && sizeof(Block) <= 8);
 
-    void normalize(){
-        int minR = 9999;
-        int minC = 9999;
-        
-        for (auto &p : cells){
-            if (p.row < minR) minR = p.row;
-            if (p.col < minC) minC = p.col;
-        }
 
-        for (auto &p : cells){
-            p.row -= minR;
-            p.col -= minC;
-        }
-    }
-};
+// A freshly spawned block of the given type. Regular blocks enter at the
+// left edge, the star block in the centre column (column 5 of 11).
+export Block makeBlock(char type, int startR = 6) {
+    Block b;
+    b.type = type;
+    b.row = static_cast<std::int16_t>(startR);
+    b.col = (type == '*') ? 5 : 0;
+    return b;
+}
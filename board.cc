@@ -1,101 +1,305 @@
 export module Board;
 
 import Block;
-import <vector>;
 import <algorithm>;
+import <array>;
+import <cstdint>;
+import <bit>;
+
+// Outcome of Board::applyMove
+export enum class MoveResult {
+    Moved,    // the move and all requested gravity rows fit
+    Blocked,  // the move itself does not fit; the block is unchanged
+    Locked    // the block came to rest while falling and must now be locked
+};
 
 export class Board {
+public:
+    // Upper bounds for the playfield; a row must fit in one 16-bit mask
+    static constexpr int MaxRows = 32;
+    static constexpr int MaxCols = 16;
+
+    // Blocks on the board are identified by small ids, reused once a block
+    // is gone; cells set without a block (setCell) carry NoBlock
+    static constexpr int MaxBlocks = MaxRows * MaxCols;
+    static constexpr std::uint16_t NoBlock = 0xFFFF;
+
+    // A cell's contents with the identity of the block it belongs to, as
+    // saved and put back by the undo journal and replay keyframes
+    struct CellRecord {
+        char symbol = ' ';
+        std::uint8_t level = 0;  // the level the block was made at
+        std::uint16_t block = NoBlock;
+    };
+
+private:
     int rows, cols;
-    std::vector<std::vector<char>> grid;
+    std::uint16_t fullMask;  // bits 0..cols-1 set
+
+    // Rows are addressed through slot[]: logical row r lives in storage row
+    // slot[r]. Clearing lines only permutes these indices, never row data.
+    std::array<std::uint8_t, MaxRows> slot;
+
+    // Occupancy bitboard per storage row: bit c is set when column c is filled
+    std::array<std::uint16_t, MaxRows> occ;
+
+    // Symbol of each cell per storage row, only meaningful where occ has a bit set
+    std::array<char, MaxRows * MaxCols> types;
+
+    // Block id of each cell per storage row, only meaningful where occ has a bit set
+    std::array<std::uint16_t, MaxRows * MaxCols> ids;
+
+    // Per block id: cells still on the board and the level it was made at.
+    // An id is free while its live count is 0; inUse mirrors that as a
+    // bitmap so the lowest free id is a count of trailing ones away.
+    struct BlockInfo {
+        std::uint8_t live;
+        std::uint8_t level;
+    };
+    std::array<BlockInfo, MaxBlocks> blocks;
+    std::array<std::uint64_t, MaxBlocks / 64> inUse;
+
+    // Skyline: colTop[c] is the highest filled row of column c, or rows if
+    // the column is empty. Kept current by restoreCell/lockBlock/clearFullRows.
+    std::array<std::uint8_t, MaxCols> colTop;
+
+    std::uint16_t& maskAt(int r) { return occ[slot[r]]; }
+    std::uint16_t maskAt(int r) const { return occ[slot[r]]; }
+    char& typeAt(int r, int c) { return types[slot[r] * MaxCols + c]; }
+    char typeAt(int r, int c) const { return types[slot[r] * MaxCols + c]; }
+    std::uint16_t& idAt(int r, int c) { return ids[slot[r] * MaxCols + c]; }
+    std::uint16_t idAt(int r, int c) const { return ids[slot[r] * MaxCols + c]; }
+
+    // One more or one fewer cell of block id on the board; true when that
+    // was its last cell
+    void addCell(std::uint16_t id) {
+        if (blocks[id].live++ == 0) inUse[id / 64] |= 1ull << (id % 64);
+    }
+    bool removeCell(std::uint16_t id) {
+        if (--blocks[id].live != 0) return false;
+        inUse[id / 64] &= ~(1ull << (id % 64));
+        return true;
+    }
+
+    // Lowest id with no cells on the board. Every block has a cell, so
+    // there are never more live blocks than cells and one is always free.
+    std::uint16_t freeBlockId() const {
+        int w = 0;
+        while (inUse[w] == ~0ull) ++w;
+        return static_cast<std::uint16_t>(w * 64 + std::countr_one(inUse[w]));
+    }
+
+    // Would a shape given as row masks fit with its top-left corner at (r, c)?
+    bool fits(const std::array<std::uint16_t, 4>& masks, int height, int r, int c) const {
+        if (height < 0 || r < 0 || r + height > rows || c < 0 || c >= cols) {
+            return false;
+        }
+        for (int i = 0; i < height; ++i) {
+            std::uint32_t m = static_cast<std::uint32_t>(masks[i]) << c;
+            if ((m & ~static_cast<std::uint32_t>(fullMask)) || (maskAt(r + i) & m)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Recompute colTop from the row masks, top row first
+    void rebuildSkyline() {
+        colTop.fill(static_cast<std::uint8_t>(rows));
+        std::uint16_t seen = 0;
+        for (int r = 0; r < rows && seen != fullMask; ++r) {
+            std::uint16_t fresh = maskAt(r) & static_cast<std::uint16_t>(~seen);
+            seen |= fresh;
+            for (; fresh; fresh &= fresh - 1) {
+                colTop[std::countr_zero(fresh)] = static_cast<std::uint8_t>(r);
+            }
+        }
+    }
 
 public:
-    Board(int r = 21, int c = 11) : rows(r), cols(c), grid(r, std::vector<char>(c, ' ')) {}
+    Board(int r = 21, int c = 11)
+        : rows(std::clamp(r, 1, MaxRows)), cols(std::clamp(c, 1, MaxCols)),
+          fullMask(static_cast<std::uint16_t>((1u << cols) - 1)) {
+        reset();
+    }
 
     // Check if a block can be placed at its current position
     bool canPlace(const Block& b) const {
-        auto absCells = b.getAbsoluteCells();
-        for (const auto& p : absCells) {
-            int r = p.row;
-            int c = p.col;
-            
-            // Check bounds
-            if (r < 0 || r >= rows || c < 0 || c >= cols) {
-                return false;
-            }
-            
-            // Check if cell is occupied
-            if (grid[r][c] != ' ') {
-                return false;
+        std::array<std::uint16_t, 4> masks;
+        int height = b.rowMasks(masks);
+        return fits(masks, height, b.row, b.col);
+    }
+
+    // Would the block fit if shifted by (dr, dc) and turned clockwise
+    // `turns` times? The block itself is not touched, so any number of
+    // callers may probe a shared const Board at once.
+    bool canPlace(const Block& b, int dr, int dc, int turns = 0) const {
+        const Orientation& from = b.current();
+        const Orientation& to = shapeFor(b.type).orient[(b.orientation + turns) & 3];
+        // Rotations keep the lower-left corner fixed (see Block::turn)
+        int r = b.row + dr + from.height - to.height;
+        return fits(to.rowMasks, to.height, r, b.col + dc);
+    }
+
+    // Shift the block by dc columns and turn it clockwise `turns` times, then
+    // let it fall up to `gravity` rows. On Blocked the block is unchanged;
+    // otherwise it is left where it stopped and `fell` holds the rows fallen.
+    MoveResult applyMove(Block& b, int dc, int turns, int gravity, int& fell) const {
+        fell = 0;
+        if (!canPlace(b, 0, dc, turns)) {
+            return MoveResult::Blocked;
+        }
+        b.col = static_cast<std::int16_t>(b.col + dc);
+        for (int k = turns & 3; k > 0; --k) {
+            b.rotateCW();
+        }
+        if (gravity <= 0) {
+            return MoveResult::Moved;
+        }
+
+        int room = landingRow(b) - b.row;
+        fell = std::min(room, gravity);
+        b.row = static_cast<std::int16_t>(b.row + fell);
+        return (room < gravity) ? MoveResult::Locked : MoveResult::Moved;
+    }
+
+    // Row the block would come to rest on if dropped straight down from its
+    // current (placeable) position. When every column of the piece is above
+    // the skyline this is a few table lookups; a piece tucked under an
+    // overhang falls back to stepping down one row at a time.
+    int landingRow(const Block& b) const {
+        const Orientation& o = b.current();
+        int land = rows - o.height;
+        for (int i = 0; i < o.width; ++i) {
+            int c = b.col + i;
+            if (c < 0 || c >= cols || b.row + o.colBottom[i] >= colTop[c]) {
+                int r = b.row;
+                while (fits(o.rowMasks, o.height, r + 1, b.col)) ++r;
+                return r;
             }
+            land = std::min(land, colTop[c] - 1 - o.colBottom[i]);
         }
-        return true;
+        return land;
     }
 
-    // Get the grid for display purposes
-    std::vector<std::vector<char>>& getGrid() {
-        return grid;
+    // How many single steps of (dr, dc) the block can take from its current
+    // position, up to maxSteps. Bounded by the board size, so a huge
+    // maxSteps costs no more than a short one.
+    int slideDistance(const Block& b, int dr, int dc, int maxSteps) const {
+        if (dr > 0 && dc == 0) {
+            return std::min(landingRow(b) - b.row, maxSteps);
+        }
+        const Orientation& o = b.current();
+        int k = 0;
+        while (k < maxSteps && fits(o.rowMasks, o.height, b.row + (k + 1) * dr, b.col + (k + 1) * dc)) {
+            ++k;
+        }
+        return k;
     }
 
-    const std::vector<std::vector<char>>& getGrid() const {
-        return grid;
+    // Height of the stack in a column (0 when the column is empty)
+    int columnHeight(int c) const {
+        return (c >= 0 && c < cols) ? rows - colTop[c] : 0;
     }
 
     // Drop block to the bottom (for hard drop)
     void dropToBottom(Block& b) {
-        while (true) {
-            b.moveDown();
-            if (!canPlace(b)) {
-                b.moveUp();
-                break;
-            }
-        }
+        b.row = static_cast<std::int16_t>(landingRow(b));
     }
 
-    // Lock a block into the grid
-    void lockBlock(const Block& b) {
-        auto absCells = b.getAbsoluteCells();
-        for (const auto& p : absCells) {
-            if (p.row >= 0 && p.row < rows && p.col >= 0 && p.col < cols) {
-                grid[p.row][p.col] = b.type;
-            }
+    // Lock a block into the grid as a new block made at `level`. The id it
+    // gets depends only on which ids are in use, so locking it again after
+    // an undo gives it the same one.
+    void lockBlock(const Block& b, int level = 0) {
+        CellRecord cell{b.type, static_cast<std::uint8_t>(level), freeBlockId()};
+        for (const auto& p : b.getAbsoluteCells()) {
+            restoreCell(p.row, p.col, cell);
         }
     }
 
-    // Clear full rows and return the number of rows cleared
+    // Clear full rows and return the number of rows cleared.
+    // One bottom-up pass packs the surviving rows' slots downwards; the
+    // storage rows of cleared lines are emptied and reused at the top.
     int clearFullRows() {
+        int points = 0;
+        return clearFullRows(points);
+    }
+
+    // As above, also adding to `points` (level + 1)^2 for each block whose
+    // last cell this clear removed, at the level the block was made
+    int clearFullRows(int& points) {
+        std::array<std::uint8_t, MaxRows> freed;
         int cleared = 0;
+        int dest = rows - 1;
 
         for (int r = rows - 1; r >= 0; --r) {
-            bool full = true;
-            for (int c = 0; c < cols; ++c) {
-                if (grid[r][c] == ' ') {
-                    full = false;
-                    break;
+            std::uint8_t s = slot[r];
+            if (occ[s] == fullMask) {
+                freed[cleared++] = s;
+                for (int c = 0; c < cols; ++c) {
+                    std::uint16_t id = ids[s * MaxCols + c];
+                    if (id != NoBlock && removeCell(id)) {
+                        points += (blocks[id].level + 1) * (blocks[id].level + 1);
+                    }
                 }
+            } else {
+                slot[dest--] = s;
             }
+        }
 
-            if (full) {
-                cleared++;
-                
-                // Move all rows above down by one
-                for (int rr = r; rr > 0; --rr) {
-                    grid[rr] = grid[rr - 1];
+        // dest is now cleared - 1: the top rows take the emptied storage
+        for (int i = 0; i < cleared; ++i) {
+            occ[freed[i]] = 0;
+            slot[i] = freed[i];
+        }
+        if (cleared > 0) {
+            rebuildSkyline();
+        }
+        return cleared;
+    }
+
+    // Rows clearFullRows would remove now (bit r = logical row r)
+    std::uint32_t fullRows() const {
+        std::uint32_t full = 0;
+        for (int r = 0; r < rows; ++r) {
+            if (maskAt(r) == fullMask) full |= 1u << r;
+        }
+        return full;
+    }
+
+    // Undo a clearFullRows: put full rows back at the logical rows in
+    // `cleared` (its fullRows() just before the clear), with `cells` giving
+    // their contents (cols per row, top row first). The empty rows the clear
+    // added at the top are taken out again.
+    void restoreRows(std::uint32_t cleared, const CellRecord* cells) {
+        std::array<std::uint8_t, MaxRows> order;
+        int emptied = 0;                    // slot[0..k) are the rows the clear emptied
+        int kept = std::popcount(cleared);  // the surviving rows follow them
+        for (int r = 0; r < rows; ++r) {
+            if (cleared & (1u << r)) {
+                std::uint8_t s = slot[emptied++];
+                occ[s] = fullMask;
+                for (int c = 0; c < cols; ++c, ++cells) {
+                    types[s * MaxCols + c] = cells->symbol;
+                    ids[s * MaxCols + c] = cells->block;
+                    if (cells->block != NoBlock) {
+                        blocks[cells->block].level = cells->level;
+                        addCell(cells->block);
+                    }
                 }
-                
-                // Clear the top row
-                grid[0] = std::vector<char>(cols, ' ');
-                
-                // Check the same row again since rows shifted down
-                r++;
+                order[r] = s;
+            } else {
+                order[r] = slot[kept++];
             }
         }
-        return cleared;
+        std::copy(order.begin(), order.begin() + rows, slot.begin());
+        rebuildSkyline();
     }
 
     // Check if a specific cell is empty
     bool isCellEmpty(int r, int c) const {
         if (r >= 0 && r < rows && c >= 0 && c < cols) {
-            return grid[r][c] == ' ';
+            return !(maskAt(r) & (1u << c));
         }
         return true;  // Out of bounds treated as empty
     }
@@ -107,26 +311,63 @@ public:
 
     // Reset the board
     void reset() {
-        for (auto& row : grid) {
-            std::fill(row.begin(), row.end(), ' ');
+        for (int r = 0; r < MaxRows; ++r) {
+            slot[r] = static_cast<std::uint8_t>(r);
         }
+        occ.fill(0);
+        types.fill(' ');
+        ids.fill(NoBlock);
+        blocks.fill(BlockInfo{0, 0});
+        inUse.fill(0);
+        colTop.fill(static_cast<std::uint8_t>(rows));
     }
 
     int numRows() const { return rows; }
     int numCols() const { return cols; }
 
+    // Occupancy mask of a row (bit c = column c)
+    std::uint16_t rowMask(int r) const {
+        return (r >= 0 && r < rows) ? maskAt(r) : 0;
+    }
+
     // Get a specific cell
     char getCell(int r, int c) const {
-        if (r >= 0 && r < rows && c >= 0 && c < cols) {
-            return grid[r][c];
+        if (!isCellEmpty(r, c)) {
+            return typeAt(r, c);
         }
         return ' ';
     }
 
-    // Set a specific cell (for testing or special blocks)
+    // A cell with its block, if any
+    CellRecord cellRecord(int r, int c) const {
+        if (isCellEmpty(r, c)) return CellRecord{};
+        std::uint16_t id = idAt(r, c);
+        return CellRecord{typeAt(r, c), id == NoBlock ? std::uint8_t{0} : blocks[id].level, id};
+    }
+
+    // Set a specific cell (for testing); it belongs to no block
     void setCell(int r, int c, char ch) {
+        restoreCell(r, c, CellRecord{ch});
+    }
+
+    // Set a cell to a saved record, taking it from whichever block held it
+    // (which does not score: only clears complete blocks)
+    void restoreCell(int r, int c, const CellRecord& cell) {
         if (r >= 0 && r < rows && c >= 0 && c < cols) {
-            grid[r][c] = ch;
+            if (!isCellEmpty(r, c) && idAt(r, c) != NoBlock) removeCell(idAt(r, c));
+            typeAt(r, c) = cell.symbol;
+            idAt(r, c) = cell.symbol == ' ' ? NoBlock : cell.block;
+            if (cell.symbol != ' ' && cell.block != NoBlock) {
+                blocks[cell.block].level = cell.level;
+                addCell(cell.block);
+            }
+            if (cell.symbol == ' ') {
+                maskAt(r) &= static_cast<std::uint16_t>(~(1u << c));
+                if (colTop[c] == r) rebuildSkyline();
+            } else {
+                maskAt(r) |= static_cast<std::uint16_t>(1u << c);
+                if (r < colTop[c]) colTop[c] = static_cast<std::uint8_t>(r);
+            }
         }
     }
 };
@@ -1,5 +1,6 @@
 export module Command;
 import <string>;
+import <cstdint>;
 
 // Use IGameController abstract class instead of GameController
 export class IGameController {
@@ -25,86 +26,35 @@ public:
     virtual void setNoRandom(const std::string& filename) = 0;
     virtual void setRandom() = 0;
 
-    virtual ~IGameController() = default;
-};
-
-// Abstract class
-export class Command {
-public:
-    virtual void execute(IGameController &gc) = 0;
-    virtual ~Command() = default;
-};
-
-// Change to IGameController
-export class MoveLeftCmd : public Command {
-public:
-    void execute(IGameController &gc) override;
-};
-
-export class MoveRightCmd : public Command {
-public:
-    void execute(IGameController &gc) override;
-};
+    // Undo history
+    virtual void undo() = 0;
+    virtual void redo() = 0;
+    virtual void branch() = 0;
 
-export class MoveDownCmd : public Command {
-public:
-    void execute(IGameController &gc) override;
-};
-
-export class DropCmd : public Command {
-public:
-    void execute(IGameController &gc) override;
-};
-
-export class RotateCwCmd : public Command {
-public:
-    void execute(IGameController &gc) override;
-};
-
-export class RotateCcwCmd : public Command {
-public:
-    void execute(IGameController &gc) override;
-};
-
-export class LevelUpCmd : public Command {
-public:
-    void execute(IGameController &gc) override;
-};
-
-export class LevelDownCmd : public Command {
-public:
-    void execute(IGameController &gc) override;
-};
-
-export class RestartCmd : public Command {
-public:
-    void execute(IGameController &gc) override;
-};
-
-export class SequenceCmd : public Command {
-    std::string filename;
-public:
-    explicit SequenceCmd(std::string file);
-    void execute(IGameController &gc) override;
-};
-
-export class ReplaceBlockCmd : public Command {
-    char blockType;
-public:
-    explicit ReplaceBlockCmd(char type);
-    void execute(IGameController &gc) override;
-};
-
-// For norandom command
-export class NoRandomCmd : public Command {
-    std::string filename;
-public:
-    explicit NoRandomCmd(std::string file);
-    void execute(IGameController &gc) override;
+    virtual ~IGameController() = default;
 };
 
-// For random command
-export class RandomCmd : public Command {
-public:
-    void execute(IGameController &gc) override;
+// One opcode per command the interpreter understands
+export enum class Opcode : std::uint8_t {
+    Invalid,
+    Left, Right, Down, Drop,
+    RotateCW, RotateCCW,
+    LevelUp, LevelDown,
+    Restart,
+    Sequence,   // arg: file name
+    Replace,    // block: block type
+    NoRandom,   // arg: file name
+    Random,
+    Undo, Redo,
+    Branch      // choose which line redo follows
+};
+
+// A compiled input line: run `op` `repeat` times. File names are interned
+// by the CommandInterpreter and referenced by index, so an instruction is a
+// small value that is copied, cached and executed without allocating.
+export struct Instruction {
+    Opcode op = Opcode::Invalid;
+    char block = ' ';    // Replace only
+    int repeat = 0;      // 0 for invalid lines and for "0left"
+    int arg = -1;        // interned file name, -1 if none
 };
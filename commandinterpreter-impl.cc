@@ -1,24 +1,64 @@
 module CommandInterpreter;
 
 import Command;
-import <iostream>;
+import InputReader;
+import <deque>;
 import <vector>;
+import <algorithm>;
 import <string>;
-import <sstream>;
+import <string_view>;
+import <unordered_map>;
+import <functional>;
+import <cstdint>;
 
 using namespace std;
 
-CommandInterpreter::CommandInterpreter() {}
+CommandInterpreter::CommandInterpreter()
+    : in{0}, prefixes(PrefixTable.begin(), PrefixTable.end()) {}
 
-string CommandInterpreter::readNextCommand() {
-    string cmd;
-    if (getline(cin, cmd)) {
-        return cmd;
+CommandInterpreter::CommandInterpreter(string_view script)
+    : in{script}, prefixes(PrefixTable.begin(), PrefixTable.end()) {}
+
+bool CommandInterpreter::readLine(string_view& line) {
+    return in.nextLine(line);
+}
+
+// Same characters operator>> skips between words
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// Word starting at or after pos; pos is left just past it
+static string_view nextWord(string_view s, size_t& pos) {
+    while (pos < s.length() && isSpace(s[pos])) ++pos;
+    size_t start = pos;
+    while (pos < s.length() && !isSpace(s[pos])) ++pos;
+    return s.substr(start, pos - start);
+}
+
+int CommandInterpreter::intern(string_view arg) {
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == arg) return static_cast<int>(i);
     }
-    return "";  // EOF
+    args.emplace_back(arg);
+    return static_cast<int>(args.size()) - 1;
+}
+
+Instruction CommandInterpreter::make(Opcode op, int repeat, char block, string_view arg) {
+    Instruction ins;
+    ins.op = op;
+    ins.repeat = repeat;
+    ins.block = block;
+    if (op == Opcode::Sequence || op == Opcode::NoRandom) ins.arg = intern(arg);
+    return ins;
+}
+
+const string& CommandInterpreter::argument(const Instruction& ins) const {
+    static const string none;
+    return (ins.arg >= 0) ? args[ins.arg] : none;
 }
 
-void CommandInterpreter::parseMultiplier(const string& input, int& multiplier, string& cmd) {
+void CommandInterpreter::parseMultiplier(string_view input, int& multiplier, string_view& cmd) {
     multiplier = 1;
     cmd = input;
     
@@ -31,156 +71,116 @@ void CommandInterpreter::parseMultiplier(const string& input, int& multiplier, s
     if (i > 0) {
         multiplier = 0;
         for (size_t j = 0; j < i; ++j) {
+            if (multiplier >= MaxMultiplier / 10) {
+                multiplier = MaxMultiplier;
+                break;
+            }
             multiplier = multiplier * 10 + (input[j] - '0');
         }
         cmd = input.substr(i);
     }
 }
 
-string CommandInterpreter::findCommandByPrefix(const string& prefix) {
-    if (prefix.empty()) return "";
-    
-    // Try exact matches first for single-letter block commands
-    if (prefix == "I" || prefix == "J" || prefix == "L" || prefix == "O" || 
-        prefix == "S" || prefix == "Z" || prefix == "T") {
-        return prefix;
-    }
-    
-    // Check each command to see if prefix matches
-    string match = "";
-    int matchCount = 0;
-    
-    // Movement commands
-    if (string("left").find(prefix) == 0) { match = "left"; ++matchCount; }
-    if (string("right").find(prefix) == 0) { match = "right"; ++matchCount; }
-    if (string("down").find(prefix) == 0) { match = "down"; ++matchCount; }
-    if (string("drop").find(prefix) == 0) { match = "drop"; ++matchCount; }
-    
-    // Rotation commands
-    if (string("clockwise").find(prefix) == 0) { match = "clockwise"; ++matchCount; }
-    if (string("counterclockwise").find(prefix) == 0) { match = "counterclockwise"; ++matchCount; }
-    
-    // Level commands
-    if (string("levelup").find(prefix) == 0) { match = "levelup"; ++matchCount; }
-    if (string("leveldown").find(prefix) == 0) { match = "leveldown"; ++matchCount; }
-    
-    // Other commands
-    if (string("restart").find(prefix) == 0) { match = "restart"; ++matchCount; }
-    if (string("norandom").find(prefix) == 0) { match = "norandom"; ++matchCount; }
-    if (string("random").find(prefix) == 0) { match = "random"; ++matchCount; }
-    if (string("sequence").find(prefix) == 0) { match = "sequence"; ++matchCount; }
-    
-    // Only return if unambiguous (exactly one match)
-    if (matchCount == 1) {
-        return match;
+static bool byPrefix(const PrefixEntry& e, string_view word) {
+    return e.prefix < word;
+}
+
+int CommandInterpreter::findCommand(string_view word) const {
+    auto it = lower_bound(prefixes.begin(), prefixes.end(), word, byPrefix);
+    if (it != prefixes.end() && it->prefix == word) {
+        return it->command;
     }
-    
-    return "";  // Not found
+    return -1;  // Unknown or ambiguous
 }
 
-Command* CommandInterpreter::parse(const string& cmdStr) {
-    if (cmdStr.empty()) {
-        return nullptr;
+bool CommandInterpreter::addAlias(string_view alias, string_view command) {
+    int target = findCommand(command);
+    if (target < 0 || alias.empty() || (alias[0] >= '0' && alias[0] <= '9')) {
+        return false;
     }
-    
-    string cmd = findCommandByPrefix(cmdStr);
-    
-    if (cmd.empty()) {
-        return nullptr;
+    for (char c : alias) {
+        if (isSpace(c)) return false;
     }
     
-    // Basic movement
-    if (cmd == "left") return new MoveLeftCmd();
-    if (cmd == "right") return new MoveRightCmd();
-    if (cmd == "down") return new MoveDownCmd();
-    if (cmd == "drop") return new DropCmd();
-    
-    // Rotation
-    if (cmd == "clockwise") return new RotateCwCmd();
-    if (cmd == "counterclockwise") return new RotateCcwCmd();
-    
-    // Level
-    if (cmd == "levelup") return new LevelUpCmd();
-    if (cmd == "leveldown") return new LevelDownCmd();
-    
-    // Restart
-    if (cmd == "restart") return new RestartCmd();
-    
-    // Random (no argument)
-    if (cmd == "random") return new RandomCmd();
-    
-    // Block replacement
-    if (cmd == "I" || cmd == "J" || cmd == "L" || cmd == "O" || 
-        cmd == "S" || cmd == "Z" || cmd == "T") {
-        return new ReplaceBlockCmd(cmd[0]);
+    auto it = lower_bound(prefixes.begin(), prefixes.end(), alias, byPrefix);
+    if (it != prefixes.end() && it->prefix == alias) {
+        it->command = static_cast<uint8_t>(target);
+    } else {
+        aliasNames.emplace_back(alias);
+        prefixes.insert(it, PrefixEntry{aliasNames.back(), static_cast<uint8_t>(target)});
     }
     
-    return nullptr;
+    // Lines compiled before may now mean something else
+    cache.clear();
+    return true;
 }
 
-vector<Command*> CommandInterpreter::parseWithMultiplier(const string& input) {
-    vector<Command*> commands;
+Instruction CommandInterpreter::parse(string_view cmdStr) {
+    Instruction ins;
+    int idx = findCommand(cmdStr);
     
-    if (input.empty()) {
-        return commands;
+    // norandom and sequence need an argument: see parseWithMultiplier
+    if (idx < 0 || Commands[idx].operand == Operand::File) {
+        return ins;
     }
     
-    // Split input into words to handle commands with arguments
-    istringstream iss(input);
-    string firstWord;
-    iss >> firstWord;
-    
-    if (firstWord.empty()) {
-        return commands;
+    ins.op = Commands[idx].op;
+    ins.repeat = 1;
+    if (ins.op == Opcode::Replace) {
+        ins.block = Commands[idx].name[0];
     }
+    return ins;
+}
+
+Instruction CommandInterpreter::parseWithMultiplier(string_view input) {
+    Instruction ins;
+    
+    // Only the first word names the command; a second word is its argument
+    size_t pos = 0;
+    string_view firstWord = nextWord(input, pos);
     
     // Parse multiplier from first word
     int multiplier;
-    string cmdStr;
+    string_view cmdStr;
     parseMultiplier(firstWord, multiplier, cmdStr);
     
-    // Find which command this is
-    string baseCmd = findCommandByPrefix(cmdStr);
-    
-    // Commands that don't support multipliers
-    if (baseCmd == "restart" || baseCmd == "norandom" || 
-        baseCmd == "random" || baseCmd == "sequence") {
-        multiplier = 1;
-    }
-    
-    // Handle norandom command (needs filename argument)
-    if (baseCmd == "norandom") {
-        string filename;
-        iss >> filename;  // Read the filename argument
-        if (!filename.empty()) {
-            commands.push_back(new NoRandomCmd(filename));
-        }
-        return commands;
+    int idx = findCommand(cmdStr);
+    if (idx < 0) {
+        return ins;
     }
     
-    // Handle sequence command (needs filename argument)
-    if (baseCmd == "sequence") {
-        string filename;
-        iss >> filename;  // Read the filename argument
-        if (!filename.empty()) {
-            commands.push_back(new SequenceCmd(filename));
+    switch (Commands[idx].operand) {
+        case Operand::File: {
+            string_view filename = nextWord(input, pos);
+            if (!filename.empty()) {
+                ins.op = Commands[idx].op;
+                ins.repeat = 1;
+                ins.arg = intern(filename);
+            }
+            break;
         }
-        return commands;
+        case Operand::Once:
+            ins = parse(cmdStr);
+            break;
+        case Operand::Repeat:
+            ins = parse(cmdStr);
+            ins.repeat = multiplier;
+            break;
     }
     
-    // Handle random command (no argument)
-    if (baseCmd == "random") {
-        commands.push_back(new RandomCmd());
-        return commands;
+    return ins;
+}
+
+Instruction CommandInterpreter::compile(string_view input) {
+    auto it = cache.find(input);
+    if (it != cache.end()) {
+        return it->second;
     }
     
-    // Generate multiplied commands for all other commands
-    for (int i = 0; i < multiplier; ++i) {
-        Command* cmd = parse(cmdStr);
-        if (cmd) {
-            commands.push_back(cmd);
-        }
+    if (cache.size() >= MaxCached) {
+        cache.clear();
     }
-    
-    return commands;
+    Instruction ins = parseWithMultiplier(input);
+    cache.emplace(input, ins);
+    return ins;
 }
@@ -1,35 +1,224 @@
 export module CommandInterpreter;
 
 import Command;
+import InputReader;
+import <deque>;
 import <vector>;
-import <sstream>;
+import <array>;
+import <algorithm>;
 import <string>;
+import <string_view>;
+import <unordered_map>;
+import <functional>;
+import <cstdint>;
+
+// How a command uses the rest of its input line
+enum class Operand : std::uint8_t {
+    Repeat,  // runs `multiplier` times
+    Once,    // ignores any multiplier
+    File     // runs once with the next word as a file name
+};
+
+struct CommandSpec {
+    std::string_view name;
+    Opcode op;
+    Operand operand;
+};
+
+// Every command the interpreter understands. Adding a command means adding
+// a row here (and a case in GameController::execute); the prefix table below
+// is derived from it at compile time.
+inline constexpr std::array<CommandSpec, 22> Commands = {{
+    // Movement
+    {"left", Opcode::Left, Operand::Repeat},
+    {"right", Opcode::Right, Operand::Repeat},
+    {"down", Opcode::Down, Operand::Repeat},
+    {"drop", Opcode::Drop, Operand::Repeat},
+
+    // Rotation
+    {"clockwise", Opcode::RotateCW, Operand::Repeat},
+    {"counterclockwise", Opcode::RotateCCW, Operand::Repeat},
+
+    // Level
+    {"levelup", Opcode::LevelUp, Operand::Repeat},
+    {"leveldown", Opcode::LevelDown, Operand::Repeat},
+
+    // Other commands
+    {"restart", Opcode::Restart, Operand::Once},
+    {"norandom", Opcode::NoRandom, Operand::File},
+    {"random", Opcode::Random, Operand::Once},
+    {"sequence", Opcode::Sequence, Operand::File},
+
+    // Undo history
+    {"undo", Opcode::Undo, Operand::Repeat},
+    {"redo", Opcode::Redo, Operand::Repeat},
+    {"branch", Opcode::Branch, Operand::Once},
+
+    // Block replacement (the block type is the name itself)
+    {"I", Opcode::Replace, Operand::Repeat},
+    {"J", Opcode::Replace, Operand::Repeat},
+    {"L", Opcode::Replace, Operand::Repeat},
+    {"O", Opcode::Replace, Operand::Repeat},
+    {"S", Opcode::Replace, Operand::Repeat},
+    {"Z", Opcode::Replace, Operand::Repeat},
+    {"T", Opcode::Replace, Operand::Repeat},
+}};
+
+// One accepted spelling of a command: a prefix of exactly one command name
+// (or a kept prefix, or a user alias), and the index of that command in Commands
+struct PrefixEntry {
+    std::string_view prefix;
+    std::uint8_t command;
+};
+
+constexpr bool isPrefixOf(std::string_view prefix, std::string_view name) {
+    return name.substr(0, prefix.size()) == prefix;
+}
+
+// Prefixes a newer command made ambiguous, kept for the command they
+// already named so existing input keeps working
+struct KeptPrefix {
+    std::string_view prefix;
+    std::string_view name;
+};
+
+inline constexpr std::array<KeptPrefix, 1> KeptPrefixes = {{
+    {"re", "restart"},  // not redo
+}};
+
+// Index in Commands of the command a prefix is accepted for: the only one
+// it starts, or the one it is kept for; -1 if none
+constexpr int prefixOwner(std::string_view prefix) {
+    for (const KeptPrefix& k : KeptPrefixes) {
+        if (k.prefix != prefix) continue;
+        for (std::size_t i = 0; i < Commands.size(); ++i) {
+            if (Commands[i].name == k.name) return static_cast<int>(i);
+        }
+    }
+    int owner = -1;
+    for (std::size_t i = 0; i < Commands.size(); ++i) {
+        if (!isPrefixOf(prefix, Commands[i].name)) continue;
+        if (owner >= 0) return -1;
+        owner = static_cast<int>(i);
+    }
+    return owner;
+}
+
+constexpr std::size_t countPrefixes() {
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < Commands.size(); ++i) {
+        for (std::size_t len = 1; len <= Commands[i].name.size(); ++len) {
+            if (prefixOwner(Commands[i].name.substr(0, len)) == static_cast<int>(i)) ++n;
+        }
+    }
+    return n;
+}
+
+// Every accepted prefix of every command, sorted for binary search
+constexpr std::array<PrefixEntry, countPrefixes()> makePrefixTable() {
+    std::array<PrefixEntry, countPrefixes()> table{};
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < Commands.size(); ++i) {
+        std::string_view name = Commands[i].name;
+        for (std::size_t len = 1; len <= name.size(); ++len) {
+            if (prefixOwner(name.substr(0, len)) == static_cast<int>(i)) {
+                table[n++] = PrefixEntry{name.substr(0, len), static_cast<std::uint8_t>(i)};
+            }
+        }
+    }
+    std::sort(table.begin(), table.end(),
+              [](const PrefixEntry& a, const PrefixEntry& b) { return a.prefix < b.prefix; });
+    return table;
+}
+
+inline constexpr auto PrefixTable = makePrefixTable();
+
+constexpr Opcode resolveConstant(std::string_view word) {
+    for (const PrefixEntry& e : PrefixTable) {
+        if (e.prefix == word) return Commands[e.command].op;
+    }
+    return Opcode::Invalid;
+}
+
+static_assert(resolveConstant("ri") == Opcode::Right && resolveConstant("cl") == Opcode::RotateCW);
+static_assert(resolveConstant("le") == Opcode::Invalid && resolveConstant("levelu") == Opcode::LevelUp);
+static_assert(resolveConstant("ra") == Opcode::Random && resolveConstant("L") == Opcode::Replace);
+static_assert(resolveConstant("re") == Opcode::Restart && resolveConstant("red") == Opcode::Redo);
 
 export class CommandInterpreter {
-    // Helper function to find command by prefix
-    std::string findCommandByPrefix(const std::string& prefix);
-    
-    // Helper to parse multiplier (e.g., "3ri" -> multiplier=3, cmd="ri")
-    void parseMultiplier(const std::string& input, int& multiplier, std::string& cmd);
-    
-    // Helper to split string by spaces
-    std::vector<std::string> split(const std::string& str);
+    InputReader in;  // command source: stdin, or an in-memory script
+
+    // PrefixTable plus any user aliases, kept sorted by prefix
+    std::vector<PrefixEntry> prefixes;
+
+    // Alias spellings; prefixes holds views into these
+    std::deque<std::string> aliasNames;
+
+    // Lets the cache be probed with a string_view
+    struct LineHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    // Lines compiled so far, so repeated input skips parsing entirely.
+    // Cleared when it grows past MaxCached distinct lines.
+    static constexpr std::size_t MaxCached = 4096;
+    std::unordered_map<std::string, Instruction, LineHash, std::equal_to<>> cache;
+
+    // Interned command arguments (file names); Instruction::arg indexes this.
+    // A deque, so references handed out stay valid while a sequence file
+    // compiles further lines.
+    std::deque<std::string> args;
+
+    // Index in Commands of the command a word names, or -1
+    int findCommand(std::string_view word) const;
+
+    // Helper to parse multiplier (e.g., "3ri" -> multiplier=3, cmd="ri").
+    // Larger multipliers are taken as MaxMultiplier; moves are bounded by
+    // the board long before that, and the arithmetic cannot overflow.
+    static constexpr int MaxMultiplier = 1000000000;
+    void parseMultiplier(std::string_view input, int& multiplier, std::string_view& cmd);
+
+    // Index of an argument in args, adding it if new
+    int intern(std::string_view arg);
 
 public:
+    // Reads stdin
     CommandInterpreter();
+    // Reads an in-memory script, which must outlive the interpreter
+    explicit CommandInterpreter(std::string_view script);
     ~CommandInterpreter() = default;
-    
-    // Read next command from input (stdin)
-    std::string readNextCommand();
-    
-    // Parse command string into Command object
-    // Returns nullptr if invalid command
-    Command* parse(const std::string& cmd);
-    
-    // Parse command with arguments (for norandom, sequence)
-    Command* parseWithArgs(const std::string& fullCmd);
-    
-    // Parse with multiplier support
-    // Returns vector of commands (for multiplied commands like "3right")
-    std::vector<Command*> parseWithMultiplier(const std::string& input);
+
+    // prefixes points into aliasNames (and in may own a buffer or mapping)
+    CommandInterpreter(const CommandInterpreter&) = delete;
+    CommandInterpreter& operator=(const CommandInterpreter&) = delete;
+
+    // Read one raw line (a command or a special action choice); false on
+    // EOF. The view is valid until the next read.
+    bool readLine(std::string_view& line);
+
+    // Could the next readLine return without waiting for input?
+    bool hasPendingInput() const { return in.hasPendingInput(); }
+
+    // Let `alias` stand for `command` (any accepted spelling of it, including
+    // another alias). Fails if the command is unknown or the alias is empty,
+    // contains spaces or starts with a digit.
+    bool addAlias(std::string_view alias, std::string_view command);
+
+    // Parse a single command word (no multiplier, no argument)
+    // Returns an Invalid instruction if the command is unknown
+    Instruction parse(std::string_view cmd);
+
+    // Parse a full input line with multiplier and argument support
+    // (e.g. "3right", "norandom seq.txt")
+    Instruction parseWithMultiplier(std::string_view input);
+
+    // parseWithMultiplier, memoized per distinct input line
+    Instruction compile(std::string_view input);
+
+    // Build an instruction directly, e.g. for a recorded command
+    Instruction make(Opcode op, int repeat, char block = ' ', std::string_view arg = {});
+
+    // The file name an instruction refers to
+    const std::string& argument(const Instruction& ins) const;
 };
@@ -6,12 +6,52 @@ import Block;
 import <iostream>;
 import <string>;
 import <vector>;
+import <array>;
 
 using namespace std;
 
+// Everything a display draws for one player, copied out of the Player so a
+// frame can be drawn later, or on another thread, while the game moves on
+export struct PlayerFrame {
+    Board board;
+    Block current;  // empty() if there is none
+    Block next;
+    int level = 0;
+    int score = 0;
+    bool blind = false;
+    bool heavy = false;
+
+    void capture(Player& p) {
+        board = p.getBoard();
+        Block* b = p.getCurrentBlock();
+        current = b ? *b : Block{};
+        b = p.getNextBlock();
+        next = b ? *b : Block{};
+        level = p.getLevel();
+        score = p.getScore();
+        blind = p.hasBlindEffect();
+        heavy = p.hasHeavyEffect();
+    }
+
+    const Block* currentBlock() const { return current.empty() ? nullptr : &current; }
+    const Block* nextBlock() const { return next.empty() ? nullptr : &next; }
+};
+
+// One immutable snapshot of both players
+export struct Frame {
+    array<PlayerFrame, 2> players;
+
+    void capture(Player& p1, Player& p2) {
+        players[0].capture(p1);
+        players[1].capture(p2);
+    }
+};
+
 export class IDisplay{
     public:
     virtual void message(const string &s) = 0;
-    virtual void render(Player& p1, Player& p2) = 0;
+    virtual void render(const Frame& frame) = 0;
+    // Displays that discard messages let the controller skip formatting them
+    virtual bool wantsMessages() const { return true; }
     virtual ~IDisplay() = default;
 };
@@ -7,19 +7,37 @@ import Block;
 import Board;
 import IDisplay;
 import Level;
+import Random;
+import InputReader;
+import Replay;
+import MatchState;
+import Journal;
 import <iostream>;
 import <vector>;
-import <fstream>;
-import <cstdlib>;
+import <array>;
 import <string>;
+import <string_view>;
+import <cstdint>;
+import <cstddef>;
+import <chrono>;
 
 using namespace std;
 
+// Messages for moves that do not fit
+static const char* const BlockedLeft = "Invalid move: cannot move current block further left.";
+static const char* const BlockedRight = "Invalid move: cannot move current block further right.";
+static const char* const BlockedDown = "Invalid move: block cannot move further down. Use 'drop' to lock it.";
+static const char* const BlockedCW = "Invalid rotation: cannot rotate block clockwise here.";
+static const char* const BlockedCCW = "Invalid rotation: cannot rotate block counter-clockwise here.";
+
 GameController::GameController(Player* p1, Player* p2, CommandInterpreter* ci, int seed, IDisplay* display)
-    : p1{p1}, p2{p2}, current{p1}, ci{ci}, display{display},hiScore{0}, gameOver{false}, randomSeed{seed} {
-    if (seed != 0) {
-        srand(seed);
-    }
+    : p1{p1}, p2{p2}, current{p1}, ci{ci}, display{display},
+      verbose{display->wantsMessages()}, hiScore{0}, gameOver{false}, randomSeed{seed},
+      commandsExecuted{0}, renderPolicy{RenderPolicy::EveryCommand}, frameInterval{},
+      lastFrame{}, framePending{false}, turnChanged{true},
+      recorder{nullptr}, replaySource{nullptr}, journal{nullptr}, executing{0} {
+    p1->setRng(Rng::stream(seed, 1));
+    p2->setRng(Rng::stream(seed, 2));
 }
 
 Player* GameController::getOpponent() {
@@ -33,12 +51,17 @@ void GameController::run() {
     // Main game loop
     while (!gameOver) {
         // Display the game state
-        if (count == 0) display->render(*p1, *p2);
+        if (count == 0) requestRender();
+        
+        // Draw a frame the render policy held back before waiting for input
+        if (framePending && renderPolicy != RenderPolicy::FinalOnly && !ci->hasPendingInput()) {
+            renderFrame();
+        }
         
         // Read and process command
-        string cmdStr = ci->readNextCommand();
+        string_view cmdStr;
         
-        if (cmdStr.empty()) {
+        if (!ci->readLine(cmdStr) || cmdStr.empty()) {
             // EOF received, exit game gracefully
             endedByEOF = true;
             break;
@@ -48,7 +71,15 @@ void GameController::run() {
         ++count;
     }
 
+    // The final state is always drawn
+    if (framePending) renderFrame();
+
+    if (recorder && !recorder->finish(MatchResult{p1->getScore(), p2->getScore(), hiScore, commandsExecuted})) {
+        cerr << "Could not write the replay file.\n";
+    }
+
     // Game End Message
+    if (!verbose) return;
     string summary = "Final scores - Player 1: " + to_string(p1->getScore()) +
                      ", Player 2: " + to_string(p2->getScore());
 
@@ -61,32 +92,147 @@ void GameController::run() {
     }
 }
 
-void GameController::processCommand(const string& cmdStr) {
-    // Parse command with multiplier support
-    vector<Command*> commands = ci->parseWithMultiplier(cmdStr);
+void GameController::processCommand(string_view cmdStr) {
+    // Compile (or fetch the cached) instruction and run it
+    execute(ci->compile(cmdStr));
     
-    // Execute each command
-    for (size_t i = 0; i < commands.size(); ++i) {
-        if (commands[i]) {
-            commands[i]->execute(*this);
-            delete commands[i];  // Clean up
-            
-            // Check if game is over after each command
-            if (gameOver) {
-                // Clean up remaining commands
-                for (size_t j = i + 1; j < commands.size(); ++j) {
-                    delete commands[j];
-                }
-                break;
-            }
+    // Redraw after all commands executed
+    requestRender();
+}
+
+void GameController::requestRender() {
+    framePending = true;
+    bool draw = false;
+    switch (renderPolicy) {
+        case RenderPolicy::EveryCommand:
+            draw = true;
+            break;
+        case RenderPolicy::TurnBoundary:
+            draw = turnChanged;
+            break;
+        case RenderPolicy::MaxFps:
+            draw = chrono::steady_clock::now() - lastFrame >= frameInterval;
+            break;
+        case RenderPolicy::FinalOnly:
+            break;
+        case RenderPolicy::Auto:
+            // Skip frames only while commands are queued up behind this one
+            draw = !ci->hasPendingInput() ||
+                   chrono::steady_clock::now() - lastFrame >= frameInterval;
+            break;
+    }
+    if (draw) renderFrame();
+}
+
+void GameController::renderFrame() {
+    frame.capture(*p1, *p2);
+    display->render(frame);
+    framePending = false;
+    turnChanged = false;
+    if (renderPolicy == RenderPolicy::MaxFps || renderPolicy == RenderPolicy::Auto) {
+        lastFrame = chrono::steady_clock::now();
+    }
+}
+
+void GameController::setRenderPolicy(RenderPolicy policy, int maxFps) {
+    renderPolicy = policy;
+    frameInterval = chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double>(1.0 / (maxFps > 0 ? maxFps : 1)));
+}
+
+// Where player i's board lies in a MatchState
+static constexpr std::size_t boardAt(std::size_t i) {
+    return offsetof(MatchState, players) + i * sizeof(PlayerState) + offsetof(PlayerState, board);
+}
+
+// The bytes of a MatchState outside the two boards: all that saveScalars
+// writes, and all the journal compares (board changes are reported to it
+// as they are made)
+static constexpr std::array<ByteRange, 3> ScalarBytes = {{
+    {0, boardAt(0)},
+    {boardAt(0) + sizeof(Board), boardAt(1)},
+    {boardAt(1) + sizeof(Board), sizeof(MatchState)},
+}};
+
+void GameController::execute(const Instruction& ins) {
+    // Sequences are recorded as the commands they run
+    if (recorder && ins.op != Opcode::Invalid && ins.op != Opcode::Sequence && ins.repeat > 0) {
+        if (recorder->wantsKeyframe()) {
+            snapshot(keyframe);
+            recorder->keyframe(keyframe);
         }
+        recorder->command(ins, ci->argument(ins));
     }
     
-    // Redraw after all commands executed
-    display->render(*p1, *p2);
+    // Each command line at the top level is one undo step; the history
+    // commands move through the journal instead
+    bool journaled = journal && executing == 0 && ins.op != Opcode::Invalid && ins.repeat > 0 &&
+                     ins.op != Opcode::Undo && ins.op != Opcode::Redo && ins.op != Opcode::Branch;
+    if (journaled) {
+        saveScalars(journalBefore);
+        journal->begin();
+    }
+    ++executing;
+    runInstruction(ins);
+    --executing;
+    if (journaled) {
+        saveScalars(journalAfter);
+        journal->commit(&journalBefore, &journalAfter, ScalarBytes);
+    }
+    
+    // A replay cannot redo these from its own history (a seek starts from a
+    // keyframe, without one), so the state they lead to is recorded
+    if (recorder && (ins.op == Opcode::Undo || ins.op == Opcode::Redo) && ins.repeat > 0) {
+        snapshot(keyframe);
+        recorder->keyframe(keyframe);
+    }
+}
+
+void GameController::runInstruction(const Instruction& ins) {
+    // Multiplied movement runs as one operation instead of step by step
+    if (ins.repeat > 1) {
+        switch (ins.op) {
+            case Opcode::Left:      repeatMove(0, -1, 0, ins.repeat, BlockedLeft); return;
+            case Opcode::Right:     repeatMove(0, 1, 0, ins.repeat, BlockedRight); return;
+            case Opcode::Down:      repeatMove(1, 0, 0, ins.repeat, BlockedDown); return;
+            case Opcode::RotateCW:  repeatMove(0, 0, 1, ins.repeat, BlockedCW); return;
+            case Opcode::RotateCCW: repeatMove(0, 0, 3, ins.repeat, BlockedCCW); return;
+            default: break;
+        }
+    }
+    
+    for (int i = 0; i < ins.repeat; ++i) {
+        switch (ins.op) {
+            case Opcode::Left:      moveLeft(); break;
+            case Opcode::Right:     moveRight(); break;
+            case Opcode::Down:      moveDown(); break;
+            case Opcode::Drop:      drop(); break;
+            case Opcode::RotateCW:  rotateCW(); break;
+            case Opcode::RotateCCW: rotateCCW(); break;
+            case Opcode::LevelUp:   levelUp(); break;
+            case Opcode::LevelDown: levelDown(); break;
+            case Opcode::Restart:   restart(); break;
+            case Opcode::Sequence:  executeSequence(ci->argument(ins)); break;
+            case Opcode::Replace:   replaceCurrentBlock(ins.block); break;
+            case Opcode::NoRandom:  setNoRandom(ci->argument(ins)); break;
+            case Opcode::Random:    setRandom(); break;
+            case Opcode::Undo:      undo(); break;
+            case Opcode::Redo:      redo(); break;
+            case Opcode::Branch:    branch(); break;
+            case Opcode::Invalid:   return;
+        }
+        ++commandsExecuted;
+        
+        // Stop repeating once the game is over
+        if (gameOver) {
+            break;
+        }
+    }
 }
 
 void GameController::startNewGame(int startLevel) {
+    // Outside a command (a new match, not a restart) the history is stale
+    if (journal && executing == 0) journal->clear();
     gameOver = false;
     
     // Reset both players
@@ -99,19 +245,21 @@ void GameController::startNewGame(int startLevel) {
     
     // Start with player 1
     current = p1;
+    turnChanged = true;
     
-    display->message("New game started at level " + to_string(startLevel) + ". Player 1 moves first.");
+    if (verbose) display->message("New game started at level " + to_string(startLevel) + ". Player 1 moves first.");
 }
 
 void GameController::restart() {
     startNewGame(0);  // Restart at level 0
     // Note: hiScore does not reset
-    display->message("Game restarted at level 0. Hi score is preserved: " + to_string(hiScore) + ".");
+    if (verbose) display->message("Game restarted at level 0. Hi score is preserved: " + to_string(hiScore) + ".");
 
 }
 
 void GameController::switchTurn() {
     current = getOpponent();
+    turnChanged = true;
 }
 
 void GameController::onBlockLocked(int rowsCleared) {
@@ -120,20 +268,17 @@ void GameController::onBlockLocked(int rowsCleared) {
         current->updateScore(rowsCleared);
     }
     
-    // Check if any blocks were fully removed from board
-    current->checkAndScoreCompletedBlocks();
-    
     // Update hi score if needed
     if (current->getScore() > hiScore) {
         hiScore = current->getScore();
-        display->message("New high score: " + to_string(hiScore) + "!");
+        if (verbose) display->message("New high score: " + to_string(hiScore) + "!");
     }
     
     // If rows cleared
     if (rowsCleared > 0) {
-        display->message("Block locked: cleared " + to_string(rowsCleared) + " line(s).");
+        if (verbose) display->message("Block locked: cleared " + to_string(rowsCleared) + " line(s).");
     } else {
-        display->message("Block locked: no lines cleared.");
+        if (verbose) display->message("Block locked: no lines cleared.");
     }
 
     // Trigger special action if 2+ rows cleared
@@ -148,7 +293,7 @@ void GameController::onBlockLocked(int rowsCleared) {
     if (!current->canPlaceCurrentBlock()) {
         gameOver = true;
         string winner = (current == p1) ? "Player 2" : "Player 1";
-        display->message(winner + " wins! No space for the next block.");
+        if (verbose) display->message(winner + " wins! No space for the next block.");
         return;
     }
     
@@ -157,187 +302,163 @@ void GameController::onBlockLocked(int rowsCleared) {
 }
 
 void GameController::triggerSpecialAction(Player* attacker, Player* defender, int rows) {
-    display->message(
+    if (verbose) display->message(
     std::string("Special action! (cleared ") + to_string(rows) + " row(s)). Choose action: blind / heavy / force <block>.");
 
-    string action;
-    if (!getline(cin, action)) {
-        display->message("No special action is chosen. Skiped");
+    // The choice comes from the same input as the commands
+    string_view action;
+    bool chosen = replaySource ? replaySource->nextSpecial(action) : ci->readLine(action);
+    if (recorder) recorder->special(chosen, action);
+    if (!chosen) {
+        if (verbose) display->message("No special action is chosen. Skiped");
         return;
     }
     
     if (action == "blind") {
         defender->applyBlindEffect();
-        display->message("Special: BLIND applied to opponent's board.");
+        if (verbose) display->message("Special: BLIND applied to opponent's board.");
     } 
     else if (action == "heavy") {
         defender->applyHeavyEffect();
-        display->message("Special: HEAVY applied. Opponent's blocks will fall faster.");
+        if (verbose) display->message("Special: HEAVY applied. Opponent's blocks will fall faster.");
     } 
     else if (action.find("force") == 0) {
         // Extract block type: "force Z" -> 'Z'
         if (action.length() >= 7) {
             char blockType = action[6];
             defender->applyForceEffect(blockType);
-            display->message(std::string("Special: FORCE applied. Opponent's next block is ") + blockType +".");
+            if (verbose) display->message(std::string("Special: FORCE applied. Opponent's next block is ") + blockType +".");
 
             
             // Check if forced block can be placed
             if (!defender->canPlaceCurrentBlock()) {
                 gameOver = true;
                 string winner = (defender == p1) ? "Player 2" : "Player 1";
-                display->message(winner + " wins! Forced block could not be placed.");
+                if (verbose) display->message(winner + " wins! Forced block could not be placed.");
             }
         } else {
-            display->message("Invalid force command. Use: force <block_type>.");
+            if (verbose) display->message("Invalid force command. Use: force <block_type>.");
         }
     } else {
-        display->message("Invalid special action: '" + action + "'. No special effect applied.");
+        if (verbose) display->message("Invalid special action: '" + string(action) + "'. No special effect applied.");
     }
 }
 
-// Helper function to handle heavy block logic (level 3+ or special action heavy)
-void GameController::moveLeft() {
+int GameController::heavyRowsFor(int dc) {
+    return (dc != 0 && current->hasHeavyEffect()) ? 2 : 0;
+}
+
+int GameController::gravityFor(int dc) {
+    return heavyRowsFor(dc) + (current->getLevel() >= 3 ? 1 : 0);
+}
+
+// Shift and/or rotate the current block, then apply heavy gravity in one
+// board query. Locks the block if it lands while falling. Returns false if
+// the move was blocked.
+bool GameController::applyMove(int dc, int turns, const char* invalidMsg) {
     Block* block = current->getCurrentBlock();
-    if (!block) return;
-    
-    Board& board = current->getBoard();
-    block->moveLeft();    
-    if (!board.canPlace(*block)) {
-        block->moveRight();  // Undo if invalid
-        display->message("Invalid move: cannot move current block further left.");
-        return;
-    }
-    
-    // Heavy effect from special action: drop 2 rows
-    if (current->hasHeavyEffect()) {
-        for (int i = 0; i < 2; ++i) {
-            block->moveDown();
-            if (!board.canPlace(*block)) {
-                block->moveUp();
-                // Block is locked if it can't move down
-                int rows = current->lockCurrentBlock();
-                display->message("Heavy effect: block locked after falling.");
-                onBlockLocked(rows);
-                return;
-            }
-        }
+    if (!block) return false;
+
+    int heavyRows = heavyRowsFor(dc);
+    int gravity = gravityFor(dc);
+
+    int fell = 0;
+    MoveResult result = current->getBoard().applyMove(*block, dc, turns, gravity, fell);
+
+    if (result == MoveResult::Blocked) {
+        if (verbose) display->message(invalidMsg);
+        return false;
     }
-    
-    // Heavy blocks from level 3+: automatically fall 1 row after movement
-    if (current->getLevel() >= 3) {
-        block->moveDown();
-        if (!board.canPlace(*block)) {
-            block->moveUp();
-            int rows = current->lockCurrentBlock();
-            display->message("Auto-drop: block locked after falling.");
-            onBlockLocked(rows);
+
+    if (result == MoveResult::Locked) {
+        int rows = current->lockCurrentBlock();
+        if (fell < heavyRows) {
+            if (verbose) display->message("Heavy effect: block locked after falling.");
+        } else if (turns != 0) {
+            if (verbose) display->message("Auto-drop: block locked after rotation.");
+        } else {
+            if (verbose) display->message("Auto-drop: block locked after falling.");
         }
+        onBlockLocked(rows);
     }
+    return true;
 }
 
-void GameController::moveRight() {
-    Block* block = current->getCurrentBlock();
-    if (!block) return;
-    
-    Board& board = current->getBoard();
-    
-    block->moveRight();
-    if (!board.canPlace(*block)) {
-        block->moveLeft();  // Undo if invalid
-        display->message("Invalid move: cannot move current block further right.");
-        return;
-    }
-    
-    // Heavy effect from special action: drop 2 rows
-    if (current->hasHeavyEffect()) {
-        for (int i = 0; i < 2; ++i) {
-            block->moveDown();
-            if (!board.canPlace(*block)) {
-                block->moveUp();
-                int rows = current->lockCurrentBlock();
-                display->message("Heavy effect: block locked after falling.");
-                onBlockLocked(rows);
-                return;
+// Same result as `count` single commands. Once a step is blocked nothing
+// has changed, so every later step is blocked too and only needs its message.
+// Without gravity nothing can lock either, so the block slides as far as it
+// fits in one collision sweep (or spins, where four turns are a no-op). With
+// gravity each step may lock the block and hand the rest of the run to the
+// other player, so steps run one at a time until one is blocked.
+void GameController::repeatMove(int dr, int dc, int turns, int count, const char* invalidMsg) {
+    int done = 0;  // steps of the final run that moved the block
+    while (true) {
+        Block* block = current->getCurrentBlock();
+        if (!block) {
+            commandsExecuted += count;
+            return;
+        }
+
+        if (dr == 0 && gravityFor(dc) > 0) {
+            bool moved = applyMove(dc, turns, invalidMsg);
+            ++commandsExecuted;
+            if (--count == 0 || gameOver) return;
+            if (moved) continue;
+            break;
+        }
+
+        Board& board = current->getBoard();
+        if (turns == 0) {
+            done = board.slideDistance(*block, dr, dc, count);
+            block->row = static_cast<std::int16_t>(block->row + dr * done);
+            block->col = static_cast<std::int16_t>(block->col + dc * done);
+        } else {
+            int fell = 0;
+            while (done < count && done < 4 &&
+                   board.applyMove(*block, 0, turns, 0, fell) == MoveResult::Moved) {
+                ++done;
+            }
+            if (done == 4) {
+                for (int k = (count - 4) % 4; k > 0; --k) {
+                    board.applyMove(*block, 0, turns, 0, fell);
+                }
+                done = count;
             }
         }
+        break;
     }
-    
-    // Heavy blocks from level 3+: automatically fall 1 row after movement
-    if (current->getLevel() >= 3) {
-        block->moveDown();
-        if (!board.canPlace(*block)) {
-            block->moveUp();
-            int rows = current->lockCurrentBlock();
-            display->message("Auto-drop: block locked after falling.");
-            onBlockLocked(rows);
-        }
+
+    commandsExecuted += count;
+    if (verbose) {
+        for (int i = done; i < count; ++i) display->message(invalidMsg);
     }
 }
 
+void GameController::moveLeft() {
+    applyMove(-1, 0, BlockedLeft);
+}
+
+void GameController::moveRight() {
+    applyMove(1, 0, BlockedRight);
+}
+
 void GameController::rotateCW() {
-    Block* block = current->getCurrentBlock();
-    if (!block) return;
-    
-    Board& board = current->getBoard();
-    
-    block->rotateCW();
-    if (!board.canPlace(*block)) {
-        block->rotateCCW();  // Undo if invalid
-        display->message("Invalid rotation: cannot rotate block clockwise here.");
-        return;
-    }
-    
-    // Heavy blocks from level 3+: automatically fall 1 row after rotation
-    if (current->getLevel() >= 3) {
-        block->moveDown();
-        if (!board.canPlace(*block)) {
-            block->moveUp();
-            int rows = current->lockCurrentBlock();
-            display->message("Auto-drop: block locked after rotation.");
-            onBlockLocked(rows);
-        }
-    }
+    applyMove(0, 1, BlockedCW);
 }
 
 void GameController::rotateCCW() {
-    Block* block = current->getCurrentBlock();
-    if (!block) return;
-    
-    Board& board = current->getBoard();
-    
-    block->rotateCCW();
-    if (!board.canPlace(*block)) {
-        block->rotateCW();  // Undo if invalid
-        display->message("Invalid rotation: cannot rotate block counter-clockwise here.");
-        return;
-    }
-    
-
-    // Heavy blocks from level 3+: automatically fall 1 row after rotation
-    if (current->getLevel() >= 3) {
-        block->moveDown();
-        if (!board.canPlace(*block)) {
-            block->moveUp();
-            int rows = current->lockCurrentBlock();
-            display->message("Auto-drop: block locked after rotation.");
-            onBlockLocked(rows);
-        }
-    }
-    ++block->countCCW;
+    applyMove(0, 3, BlockedCCW);
 }
 
 void GameController::moveDown() {
     Block* block = current->getCurrentBlock();
     if (!block) return;
     
-    Board& board = current->getBoard();
-    
-    block->moveDown();
-    if (!board.canPlace(*block)) {
-        block->moveUp();
+    if (current->getBoard().canPlace(*block, 1, 0)) {
+        block->moveDown();
+    } else {
         // Don't lock on down command, only drop locks
-        display->message("Invalid move: block cannot move further down. Use 'drop' to lock it.");
+        if (verbose) display->message(BlockedDown);
     }
 }
 
@@ -347,18 +468,12 @@ void GameController::drop() {
     
     Board& board = current->getBoard();
     
-    // Drop until collision
-    while (true) {
-        block->moveDown();
-        if (!board.canPlace(*block)) {
-            block->moveUp();  // Undo last invalid move
-            break;
-        }
-    }
+    // Drop straight to the landing row found from the board's skyline
+    board.dropToBottom(*block);
     
     // Lock the block
     int rows = current->lockCurrentBlock();
-    display->message("Block dropped and locked.");
+    if (verbose) display->message("Block dropped and locked.");
     onBlockLocked(rows);
 }
 
@@ -366,9 +481,9 @@ void GameController::levelUp() {
     int currentLevel = current->getLevel();
     if (currentLevel < 4) {  // Max level is 4
         current->setLevel(currentLevel + 1);
-        display->message("Level increased to " + to_string(currentLevel + 1) + ".");
+        if (verbose) display->message("Level increased to " + to_string(currentLevel + 1) + ".");
     } else {
-        display->message("Level up not possible: already at maximum level 4.");
+        if (verbose) display->message("Level up not possible: already at maximum level 4.");
     }
 }
 
@@ -376,52 +491,52 @@ void GameController::levelDown() {
     int currentLevel = current->getLevel();
     if (currentLevel > 0) {  // Min level is 0
         current->setLevel(currentLevel - 1);
-        display->message("Level decreased to " + to_string(currentLevel - 1) + ".");
+        if (verbose) display->message("Level decreased to " + to_string(currentLevel - 1) + ".");
     } else {
-        display->message("Level down not possible: already at minimum level 0.");
+        if (verbose) display->message("Level down not possible: already at minimum level 0.");
     }
 }
 
 void GameController::executeSequence(const string& filename) {
-    ifstream file(filename);
-    if (!file) {
-        display->message("Error: could not open sequence file " + filename + ".");
+    InputReader file;
+    if (!file.open(filename)) {
+        if (verbose) display->message("Error: could not open sequence file " + filename + ".");
         return;
     }
 
-    display->message("Executing command sequence from file " + filename + ".");
+    if (verbose) display->message("Executing command sequence from file " + filename + ".");
 
-    string cmd;
-    while (file >> cmd) {
-        if (!cmd.empty()) {
-            processCommand(cmd);
-            
-            // Check if game is over
-            if (gameOver) {
-                break;
-            }
+    // One command per word, as with operator>>
+    string_view cmd;
+    while (file.nextWord(cmd)) {
+        processCommand(cmd);
+        
+        // Check if game is over
+        if (gameOver) {
+            break;
         }
     }
     
     if (!gameOver) {
-        display->message("Finished executing sequence from " + filename + ".");
+        if (verbose) display->message("Finished executing sequence from " + filename + ".");
     }
-    
-    file.close();
 }
 
 void GameController::replaceCurrentBlock(char blockType) {
     current->replaceCurrentBlock(blockType);
-    display->message(string("Current block replaced with ") + blockType + "'.");
+    if (verbose) display->message(string("Current block replaced with ") + blockType + "'.");
 }
 
 void GameController::setNoRandom(const string& filename) {
     int level = current->getLevel();
-    if (level == 3 || level == 4) {
+    if (filename.size() > LevelState::MaxFileName) {
+        // Snapshots hold the file name in a fixed-size field
+        if (verbose) display->message("NoRandom file name is too long.");
+    } else if (level == 3 || level == 4) {
         current->setNoRandom(filename);
-        display->message(std::string("Non-random mode enabled at level ") + to_string(level) + std::string(" using file ") + filename + ".");
+        if (verbose) display->message(std::string("Non-random mode enabled at level ") + to_string(level) + std::string(" using file ") + filename + ".");
     } else {
-        display->message(std::string("NoRandom command only works for levels 3 and 4. Current level is") + to_string(level) + ".");
+        if (verbose) display->message(std::string("NoRandom command only works for levels 3 and 4. Current level is") + to_string(level) + ".");
     }
 }
 
@@ -429,14 +544,97 @@ void GameController::setRandom() {
     int level = current->getLevel();
     if (level == 3 || level == 4) {
         current->setRandom();
-        display->message(std::string("Random mode restored at level ") + to_string(level) + ".");
+        if (verbose) display->message(std::string("Random mode restored at level ") + to_string(level) + ".");
     } else {
-        display->message(std::string("Random command only works for levels 3 and 4. Current level is ") + to_string(level) + ".");
+        if (verbose) display->message(std::string("Random command only works for levels 3 and 4. Current level is ") + to_string(level) + ".");
     }
 }
 
 void GameController::setSeed(int seed) {
     randomSeed = seed;
-    srand(seed);
-    display->message(std::string("Random seed set to ") + to_string(seed) + ".");
+    p1->setRng(Rng::stream(seed, 1));
+    p2->setRng(Rng::stream(seed, 2));
+    if (verbose) display->message(std::string("Random seed set to ") + to_string(seed) + ".");
+}
+
+void GameController::snapshot(MatchState& s) const {
+    saveScalars(s);
+    s.players[0].board = p1->getBoard();
+    s.players[1].board = p2->getBoard();
+}
+
+void GameController::restore(const MatchState& s) {
+    p1->getBoard() = s.players[0].board;
+    p2->getBoard() = s.players[1].board;
+    restoreScalars(s);
+    // The history no longer leads here
+    if (journal) journal->clear();
+}
+
+void GameController::saveScalars(MatchState& s) const {
+    p1->saveScalars(s.players[0]);
+    p2->saveScalars(s.players[1]);
+    s.current = (current == p1) ? 0 : 1;
+    s.hiScore = hiScore;
+    s.gameOver = gameOver;
+    s.commandsExecuted = commandsExecuted;
+}
+
+void GameController::restoreScalars(const MatchState& s) {
+    p1->restoreScalars(s.players[0]);
+    p2->restoreScalars(s.players[1]);
+    current = (s.current == 0) ? p1 : p2;
+    hiScore = s.hiScore;
+    gameOver = s.gameOver;
+    commandsExecuted = s.commandsExecuted;
+    framePending = true;
+    turnChanged = true;
+}
+
+void GameController::setJournal(Journal* j) {
+    journal = j;
+    p1->setJournal(j, 0);
+    p2->setJournal(j, 1);
+    if (j) j->clear();
+}
+
+bool GameController::stepJournal(bool forward) {
+    saveScalars(journalBefore);
+    std::array<Board*, 2> boards{&p1->getBoard(), &p2->getBoard()};
+    if (!(forward ? journal->redo(boards, &journalBefore) : journal->undo(boards, &journalBefore))) {
+        return false;
+    }
+    restoreScalars(journalBefore);
+    return true;
+}
+
+void GameController::undo() {
+    if (!journal || executing > 1) {
+        if (verbose) display->message(journal ? "Undo is not available inside a sequence." : "Undo is not enabled.");
+    } else if (!stepJournal(false)) {
+        if (verbose) display->message("Nothing to undo.");
+    } else {
+        if (verbose) display->message("Undid the last command.");
+    }
+}
+
+void GameController::redo() {
+    if (!journal || executing > 1) {
+        if (verbose) display->message(journal ? "Redo is not available inside a sequence." : "Undo is not enabled.");
+    } else if (!stepJournal(true)) {
+        if (verbose) display->message("Nothing to redo.");
+    } else {
+        if (verbose) display->message("Redid the next command.");
+    }
+}
+
+void GameController::branch() {
+    int which = 0, count = 0;
+    if (!journal) {
+        if (verbose) display->message("Undo is not enabled.");
+    } else if (!journal->branch(which, count)) {
+        if (verbose) display->message("Only one line continues from here.");
+    } else {
+        if (verbose) display->message("Redo now follows line " + to_string(which) + " of " + to_string(count) + ".");
+    }
 }
@@ -7,11 +7,26 @@ import Block;
 import Board;
 import IDisplay;
 import Level;
+import Replay;
+import MatchState;
+import Journal;
 import <iostream>;
 import <string>;
+import <string_view>;
+import <chrono>;
 
 using namespace std;
 
+// When the display is redrawn. Whatever the policy, the final state is
+// always drawn before the game loop returns.
+export enum class RenderPolicy {
+    EveryCommand,  // after every command line, and every command of a sequence
+    TurnBoundary,  // only after the turn has passed to the other player
+    MaxFps,        // at most maxFps frames per second
+    FinalOnly,     // only the final state
+    Auto           // when input is idle; while it backs up, at most maxFps
+};
+
 
 export class GameController : public IGameController{
     Player* p1;
@@ -19,13 +34,61 @@ export class GameController : public IGameController{
     Player* current;
     CommandInterpreter* ci;
     IDisplay* display;
+    bool verbose;  // false when the display ignores messages (headless)
     
     int hiScore;  // Persists across restarts
     bool gameOver;
-    int randomSeed;  // For -seed command line option
+    int randomSeed;  // Match seed; each player draws from its own stream of it
+    long long commandsExecuted;  // Individual commands run (after multipliers)
+    
+    // Render throttling
+    RenderPolicy renderPolicy;
+    chrono::steady_clock::duration frameInterval;  // MaxFps/Auto
+    chrono::steady_clock::time_point lastFrame;
+    bool framePending;  // the state changed since the last frame
+    bool turnChanged;   // the turn passed since the last frame
+    Frame frame;        // reused snapshot handed to the display
+    
+    // Recording and replaying (both null during normal play)
+    ReplayWriter* recorder;       // every executed command and special action
+    ReplayReader* replaySource;   // special actions come from here, not input
+    MatchState keyframe;          // reused for the recorder's keyframes
+    
+    // Undo history (null when undo is off). Each top-level command line is
+    // one entry; the rest of the state is diffed through the two scratch
+    // states, which only ever hold everything but the boards.
+    Journal* journal;
+    MatchState journalBefore, journalAfter;
+    int executing;  // execute() calls in progress (sequences nest them)
     
     // Helper to get opponent of current player
     Player* getOpponent();
+    
+    // Rows a horizontal move (dc != 0) or rotation lets the block fall:
+    // heavyRowsFor(dc), plus 1 at level 3+
+    int gravityFor(int dc);
+    // The heavy special action's part of that: 2 for moves, 0 otherwise
+    int heavyRowsFor(int dc);
+    
+    // Shared body of the movement/rotation commands; false if blocked
+    bool applyMove(int dc, int turns, const char* invalidMsg);
+    
+    // Run `count` repetitions of a move, down or rotation as one operation
+    void repeatMove(int dr, int dc, int turns, int count, const char* invalidMsg);
+    
+    // The body of execute()
+    void runInstruction(const Instruction& ins);
+    
+    // Match state without the boards, for the journal
+    void saveScalars(MatchState& s) const;
+    void restoreScalars(const MatchState& s);
+    
+    // Undo (forward = false) or redo one journal entry; false if there is none
+    bool stepJournal(bool forward);
+    
+    // Note that the state changed and draw it if the render policy allows
+    void requestRender();
+    void renderFrame();
 
 public:
     GameController(Player* p1, Player* p2, CommandInterpreter* ci, int seed, IDisplay* display);
@@ -35,7 +98,10 @@ public:
     void run();
     
     // Process a single command string
-    void processCommand(const string& cmd);
+    void processCommand(string_view cmd);
+    
+    // Run a compiled command line
+    void execute(const Instruction& ins);
     
     // Initialize/restart game
     void startNewGame(int startLevel = 0);
@@ -68,11 +134,36 @@ public:
     void setNoRandom(const string& filename) override;
     void setRandom() override;
     
-    // Set random seed
+    // Undo history commands
+    void undo() override;
+    void redo() override;
+    void branch() override;
+    
+    // Set the match seed and reseed both players' piece streams
     void setSeed(int seed);
     
+    // Choose when the display is redrawn (maxFps applies to MaxFps and Auto)
+    void setRenderPolicy(RenderPolicy policy, int maxFps = 30);
+    
+    // Record the match; run() writes the recording when the match ends
+    void setRecorder(ReplayWriter* writer) { recorder = writer; }
+    // Take special action choices from a recording (see verifyReplay)
+    void setReplaySource(ReplayReader* reader) { replaySource = reader; }
+    
+    // Keep undo history in `j` from now on (null turns undo off)
+    void setJournal(Journal* j);
+    
+    // Snapshots of the whole match (players, turn, counters). Neither
+    // touches files, except that restoring to a level a player has never
+    // been at, or a norandom file a level has never read, reads it (see
+    // Player::levelFor, NoRandomFiles); MatchState also has an on-disk
+    // form.
+    void snapshot(MatchState& s) const;
+    void restore(const MatchState& s);
+    
     // Getters
     Player* getCurrentPlayer() { return current; }
     int getHiScore() const { return hiScore; }
     bool isGameOver() const { return gameOver; }
+    long long getCommandsExecuted() const { return commandsExecuted; }
 };
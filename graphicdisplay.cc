@@ -10,16 +10,25 @@ import <X11/Xutil.h>;
 import <iostream>;
 import <vector>;
 import <string>;
+import <array>;
 import <memory>;
 import <cstring>;
 
 using namespace std;
 using XDisplay = ::Display;
 
+// Draws into an off-screen Pixmap and copies it to the window in one
+// XCopyArea per frame. Only cells whose contents changed since the last
+// frame are repainted, with one XFillRectangles call per colour; Expose
+// events are answered from the back buffer.
 export class GraphicDisplay : public IDisplay {
+    static constexpr int Width = 600, Height = 500;
+    static constexpr int NumColors = 9;  // 0 = empty (white), 1-8 = block types
+
     XDisplay* dpy;
     Window win;
     GC gc;
+    Pixmap back;
 
     const int cellSize = 20;
 
@@ -30,6 +39,22 @@ export class GraphicDisplay : public IDisplay {
     // Store current message to display
     string currentMessage;
 
+    // What the back buffer currently shows for one player
+    struct Shown {
+        array<char, Board::MaxRows * Board::MaxCols> cells;  // '?' while blind
+        int level, score;
+        char next;
+    };
+    array<Shown, 2> shown;
+    bool drawn = false;  // back buffer holds a complete frame
+
+    // Work queued while updating the back buffer, drawn in a fixed order:
+    // white fills, cell outlines, coloured fills, then text on top
+    array<vector<XRectangle>, NumColors> fills;
+    vector<XRectangle> outlines;
+    vector<XPoint> blindMarks;
+    array<bool, 2> textDirty{};
+
 public:
     GraphicDisplay() {
         dpy = XOpenDisplay(nullptr);
@@ -44,60 +69,82 @@ public:
 
         win = XCreateSimpleWindow(dpy, DefaultRootWindow(dpy),
                                   10, 10,
-                                  600, 500,
+                                  Width, Height,
                                   1, black, white);
 
         XSelectInput(dpy, win, ExposureMask | KeyPressMask);
         XMapWindow(dpy, win);
 
         gc = XCreateGC(dpy, win, 0, nullptr);
+        back = XCreatePixmap(dpy, win, Width, Height, DefaultDepth(dpy, screen));
 
         initColors();
     }
 
     ~GraphicDisplay() {
+        XFreePixmap(dpy, back);
         XFreeGC(dpy, gc);
         XDestroyWindow(dpy, win);
         XCloseDisplay(dpy);
     }
 
+    // Messages are drawn into the back buffer and copied to the window, but
+    // not flushed: they go out with the next frame
     void message(const string& s) override {
         currentMessage = s;
         // Also print to console for debugging
         cout << "[Graphic] " << s << endl;
-        // Redraw message area
+        if (!drawn) return;  // drawn with the first frame
+
         drawMessage();
-        XFlush(dpy);
+        XCopyArea(dpy, back, win, gc, 0, MessageTop, Width, Height - MessageTop, 0, MessageTop);
     }
 
-    void render(Player& p1, Player& p2) override {
-        XClearWindow(dpy, win);
+    void render(const Frame& f) override {
+        handleEvents();
+        if (!drawn) paintBackground();
 
-        drawBoard(50, p1);      // left board at x=50
-        drawBoard(350, p2);     // right board at x=350
+        updateBoard(0, 50, f.players[0]);      // left board at x=50
+        updateBoard(1, 350, f.players[1]);     // right board at x=350
 
-        // Draw next blocks
-        drawNextBlock(50, 400, p1.getNextBlock());
-        drawNextBlock(350, 400, p2.getNextBlock());
+        // Next blocks
+        updateNextBlock(0, 50, 400, f.players[0].nextBlock());
+        updateNextBlock(1, 350, 400, f.players[1].nextBlock());
 
-        // Draw message at the bottom
-        drawMessage();
+        drawQueued(f);
 
+        XCopyArea(dpy, back, win, gc, 0, 0, Width, Height, 0, 0);
         XFlush(dpy);
     }
 
 private:
-    unsigned long colorFor(char ch) {
+    static constexpr int TextTop = 361;     // level/score strip below the boards
+    static constexpr int TextHeight = 26;
+    static constexpr int MessageTop = 465;  // message strip at the bottom
+
+    // Answer Expose from the back buffer; other events are ignored
+    void handleEvents() {
+        while (XPending(dpy) > 0) {
+            XEvent ev;
+            XNextEvent(dpy, &ev);
+            if (ev.type == Expose && drawn) {
+                XCopyArea(dpy, back, win, gc, ev.xexpose.x, ev.xexpose.y,
+                          ev.xexpose.width, ev.xexpose.height, ev.xexpose.x, ev.xexpose.y);
+            }
+        }
+    }
+
+    int colorIndex(char ch) {
         switch (ch) {
-            case 'I': return colors[1];
-            case 'J': return colors[2];
-            case 'L': return colors[3];
-            case 'O': return colors[4];
-            case 'S': return colors[5];
-            case 'Z': return colors[6];
-            case 'T': return colors[7];
-            case '*': return colors[8];
-            default: return white;
+            case 'I': return 1;
+            case 'J': return 2;
+            case 'L': return 3;
+            case 'O': return 4;
+            case 'S': return 5;
+            case 'Z': return 6;
+            case 'T': return 7;
+            case '*': return 8;
+            default: return 0;
         }
     }
 
@@ -111,6 +158,7 @@ private:
             colors[idx] = xc.pixel;
         };
 
+        colors[0] = white;
         set(1, "cyan");
         set(2, "blue");
         set(3, "orange");
@@ -121,133 +169,165 @@ private:
         set(8, "gray");
     }
 
-    void drawBoard(int xOffset, Player& p) {
-        Board& b = p.getBoard();
+    // Blank back buffer with the static parts (cell outlines, labels); every
+    // cell and text field is then repainted by the first update
+    void paintBackground() {
+        XSetForeground(dpy, gc, white);
+        XFillRectangle(dpy, back, gc, 0, 0, Width, Height);
+
+        for (int i = 0; i < 2; ++i) {
+            shown[i].cells.fill('\0');
+            shown[i].level = shown[i].score = -1;
+            shown[i].next = '\0';
+        }
+        drawText(50, 400, "Next:");
+        drawText(350, 400, "Next:");
+        drawMessage();
+        drawn = true;
+    }
+
+    XRectangle cellRect(int x, int y) {
+        return XRectangle{static_cast<short>(x + 1), static_cast<short>(y + 1),
+                          static_cast<unsigned short>(cellSize - 1),
+                          static_cast<unsigned short>(cellSize - 1)};
+    }
+
+    // Queue a cell: its outline, its fill, and the blind '?' if any
+    void queueCell(int x, int y, char look) {
+        outlines.push_back(XRectangle{static_cast<short>(x), static_cast<short>(y),
+                                      static_cast<unsigned short>(cellSize),
+                                      static_cast<unsigned short>(cellSize)});
+        fills[look == '?' ? 0 : colorIndex(look)].push_back(cellRect(x, y));
+        if (look == '?') {
+            blindMarks.push_back(XPoint{static_cast<short>(x), static_cast<short>(y)});
+        }
+    }
+
+    void updateBoard(int i, int xOffset, const PlayerFrame& p) {
+        const Board& b = p.board;
+        Shown& s = shown[i];
+
+        // The level/score text overlaps the bottom row, so a change to
+        // either repaints that row under the new text
+        bool textChanged = p.level != s.level || p.score != s.score;
+        if (textChanged) {
+            s.level = p.level;
+            s.score = p.score;
+            fills[0].push_back(XRectangle{static_cast<short>(xOffset), TextTop,
+                                          static_cast<unsigned short>(250), TextHeight});
+            textDirty[i] = true;
+        }
 
-        // Copy grid and overlay current block
-        vector<vector<char>> grid = b.getGrid();
-        Block* curr = p.getCurrentBlock();
+        // Current contents, with the current block overlaid
+        array<char, Board::MaxRows * Board::MaxCols> look;
+        int rows = b.numRows(), cols = b.numCols();
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                look[r * cols + c] = b.getCell(r, c);
+            }
+        }
+        const Block* curr = p.currentBlock();
         if (curr) {
             for (auto& pos : curr->getAbsoluteCells()) {
-                if (pos.row >= 0 && pos.row < b.numRows() &&
-                    pos.col >= 0 && pos.col < b.numCols()) {
-                    grid[pos.row][pos.col] = curr->type;
+                if (pos.row >= 0 && pos.row < rows && pos.col >= 0 && pos.col < cols) {
+                    look[pos.row * cols + pos.col] = curr->type;
                 }
             }
         }
-
-        for (int r = 3; r < b.numRows(); ++r) {  // skip top 3 rows
-            for (int c = 0; c < b.numCols(); ++c) {
-                
-		char ch = grid[r][c];
-		if (!(p.hasBlindEffect())){
-                drawCell(xOffset + c * cellSize,
-                         (r - 3) * cellSize,
-                         colorFor(ch));
-		} else {
-		       drawCell(xOffset + c * cellSize,
-                         (r - 3) * cellSize,white);
-		     XSetForeground(dpy, gc, black);
-		    XDrawString(dpy,win,gc,xOffset + c *cellSize,(r - 3) * cellSize, "?", 1);
-                }
+        bool blind = p.blind;
+
+        for (int r = 3; r < rows; ++r) {  // skip top 3 rows
+            bool bottomRow = (r == rows - 1);
+            for (int c = 0; c < cols; ++c) {
+                char ch = blind ? '?' : look[r * cols + c];
+                char& old = s.cells[r * cols + c];
+                if (ch == old && !(bottomRow && textChanged)) continue;
+                old = ch;
+                queueCell(xOffset + c * cellSize, (r - 3) * cellSize, ch);
             }
+            if (bottomRow && textChanged) textDirty[i] = true;
         }
-
-        drawText(xOffset, 360, ("Level: " + to_string(p.getLevel())).c_str());
-        drawText(xOffset, 380, ("Score: " + to_string(p.getScore())).c_str());
     }
 
-    void drawNextBlock(int xOffset, int yOffset, Block* nextBlock) {
-        drawText(xOffset, yOffset, "Next:");
+    // Shape of each block in its canonical orientation, as in the text display
+    static const char* previewRow(char type, int row) {
+        switch (type) {
+            case 'I': return row == 0 ? "IIII" : "";
+            case 'J': return row == 0 ? "J" : "JJJ";
+            case 'L': return row == 0 ? "  L" : "LLL";
+            case 'O': return "OO";
+            case 'S': return row == 0 ? " SS" : "SS";
+            case 'Z': return row == 0 ? "ZZ" : " ZZ";
+            case 'T': return row == 0 ? "TTT" : " T";
+            case '*': return row == 0 ? "*" : "";
+            default: return "";
+        }
+    }
 
-        if (!nextBlock) return;
+    void updateNextBlock(int i, int xOffset, int yOffset, const Block* nextBlock) {
+        char type = nextBlock ? nextBlock->getSymbol() : ' ';
+        if (type == shown[i].next) return;
+        shown[i].next = type;
 
-        char type = nextBlock->getSymbol();
         int startY = yOffset + 5;  // Start drawing cells below "Next:" label
-
-        // Draw the next block pattern based on type (similar to textdisplay.cc)
-        // Each block is drawn in its canonical orientation
-        switch (type) {
-            case 'I':
-                // IIII (1 row, 4 cols)
-                for (int c = 0; c < 4; ++c) {
-                    drawCell(xOffset + c * cellSize, startY, colorFor('I'));
+        fills[0].push_back(XRectangle{static_cast<short>(xOffset), static_cast<short>(startY),
+                                      static_cast<unsigned short>(4 * cellSize + 1),
+                                      static_cast<unsigned short>(2 * cellSize + 1)});
+        for (int r = 0; r < 2; ++r) {
+            const char* pattern = previewRow(type, r);
+            for (int c = 0; pattern[c]; ++c) {
+                if (pattern[c] != ' ') {
+                    queueCell(xOffset + c * cellSize, startY + r * cellSize, type);
                 }
-                break;
-            case 'J':
-                // J
-                // JJJ
-                drawCell(xOffset, startY, colorFor('J'));
-                for (int c = 0; c < 3; ++c) {
-                    drawCell(xOffset + c * cellSize, startY + cellSize, colorFor('J'));
-                }
-                break;
-            case 'L':
-                //   L
-                // LLL
-                drawCell(xOffset + 2 * cellSize, startY, colorFor('L'));
-                for (int c = 0; c < 3; ++c) {
-                    drawCell(xOffset + c * cellSize, startY + cellSize, colorFor('L'));
-                }
-                break;
-            case 'O':
-                // OO
-                // OO
-                for (int r = 0; r < 2; ++r) {
-                    for (int c = 0; c < 2; ++c) {
-                        drawCell(xOffset + c * cellSize, startY + r * cellSize, colorFor('O'));
-                    }
-                }
-                break;
-            case 'S':
-                //  SS
-                // SS
-                drawCell(xOffset + cellSize, startY, colorFor('S'));
-                drawCell(xOffset + 2 * cellSize, startY, colorFor('S'));
-                drawCell(xOffset, startY + cellSize, colorFor('S'));
-                drawCell(xOffset + cellSize, startY + cellSize, colorFor('S'));
-                break;
-            case 'Z':
-                // ZZ
-                //  ZZ
-                drawCell(xOffset, startY, colorFor('Z'));
-                drawCell(xOffset + cellSize, startY, colorFor('Z'));
-                drawCell(xOffset + cellSize, startY + cellSize, colorFor('Z'));
-                drawCell(xOffset + 2 * cellSize, startY + cellSize, colorFor('Z'));
-                break;
-            case 'T':
-                // TTT
-                //  T
-                for (int c = 0; c < 3; ++c) {
-                    drawCell(xOffset + c * cellSize, startY, colorFor('T'));
-                }
-                drawCell(xOffset + cellSize, startY + cellSize, colorFor('T'));
-                break;
-            case '*':
-                // * (single cell)
-                drawCell(xOffset, startY, colorFor('*'));
-                break;
-            default:
-                break;
+            }
+        }
+    }
+
+    // Issue everything queued by the updates, one request per colour
+    void drawQueued(const Frame& f) {
+        if (!fills[0].empty()) {
+            XSetForeground(dpy, gc, colors[0]);
+            XFillRectangles(dpy, back, gc, fills[0].data(), static_cast<int>(fills[0].size()));
+            fills[0].clear();
+        }
+        if (!outlines.empty()) {
+            XSetForeground(dpy, gc, black);
+            XDrawRectangles(dpy, back, gc, outlines.data(), static_cast<int>(outlines.size()));
+            outlines.clear();
+        }
+        for (int k = 1; k < NumColors; ++k) {
+            if (fills[k].empty()) continue;
+            XSetForeground(dpy, gc, colors[k]);
+            XFillRectangles(dpy, back, gc, fills[k].data(), static_cast<int>(fills[k].size()));
+            fills[k].clear();
+        }
+
+        XSetForeground(dpy, gc, black);
+        for (const XPoint& pt : blindMarks) {
+            XDrawString(dpy, back, gc, pt.x, pt.y, "?", 1);
+        }
+        blindMarks.clear();
+
+        for (int i = 0; i < 2; ++i) {
+            if (!textDirty[i]) continue;
+            int xOffset = (i == 0) ? 50 : 350;
+            drawText(xOffset, 360, ("Level: " + to_string(f.players[i].level)).c_str());
+            drawText(xOffset, 380, ("Score: " + to_string(f.players[i].score)).c_str());
+            textDirty[i] = false;
         }
     }
 
     void drawMessage() {
+        XSetForeground(dpy, gc, white);
+        XFillRectangle(dpy, back, gc, 0, MessageTop, Width, Height - MessageTop);
         if (!currentMessage.empty()) {
             // Draw message at the bottom of the window
             drawText(50, 480, currentMessage.c_str());
         }
     }
 
-    void drawCell(int x, int y, unsigned long color) {
-        XSetForeground(dpy, gc, black);
-        XDrawRectangle(dpy, win, gc, x, y, cellSize, cellSize);
-        XSetForeground(dpy, gc, color);
-        XFillRectangle(dpy, win, gc, x + 1, y + 1, cellSize - 1, cellSize - 1);
-    }
-
     void drawText(int x, int y, const char* text) {
         XSetForeground(dpy, gc, black);
-        XDrawString(dpy, win, gc, x, y, text, strlen(text));
+        XDrawString(dpy, back, gc, x, y, text, strlen(text));
     }
 };
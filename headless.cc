@@ -0,0 +1,122 @@
+export module Headless;
+
+import GameController;
+import CommandInterpreter;
+import Player;
+import NullDisplay;
+import WorkStealing;
+import <iostream>;
+import <sstream>;
+import <string>;
+import <vector>;
+import <chrono>;
+import <thread>;
+
+using namespace std;
+
+// One command script shared by many matches
+export struct CommandScript {
+    string name;
+    string commands;
+};
+
+export struct HeadlessOptions {
+    int games = 1;          // seeds seed, seed + 1, ..., seed + games - 1
+    int seed = 0;
+    vector<int> levels{0};  // start levels to sweep for every seed
+    vector<CommandScript> scripts;
+    int threads = 0;        // 0 = one per hardware thread
+    string scriptFile1 = "biquadris_sequence1.txt";
+    string scriptFile2 = "biquadris_sequence2.txt";
+};
+
+export struct GameResult {
+    int score1, score2;
+    long long commands;    // individual commands executed
+    bool gameOver;         // false if the script ran out first
+};
+
+// Play one complete game with no display, reading commands (and special
+// action choices) from an in-memory script
+export GameResult playHeadless(const string& commands, int seed, int startLevel,
+                               const string& scriptFile1, const string& scriptFile2) {
+    Player p1(startLevel, scriptFile1);
+    Player p2(startLevel, scriptFile2);
+    CommandInterpreter ci(commands);
+    NullDisplay display;
+
+    GameController gc(&p1, &p2, &ci, seed, &display);
+    gc.setRenderPolicy(RenderPolicy::FinalOnly);
+    gc.startNewGame(startLevel);
+    gc.run();
+
+    return GameResult{p1.getScore(), p2.getScore(), gc.getCommandsExecuted(), gc.isGameOver()};
+}
+
+// Parse a start level list such as "0-4" or "1,3"; invalid entries are skipped
+export vector<int> parseLevelList(const string& spec) {
+    vector<int> levels;
+    stringstream ss(spec);
+    string part;
+    while (getline(ss, part, ',')) {
+        size_t dash = part.find('-');
+        try {
+            int lo = stoi(part.substr(0, dash));
+            int hi = (dash == string::npos) ? lo : stoi(part.substr(dash + 1));
+            for (int l = lo; l <= hi; ++l) {
+                if (l >= 0 && l <= 4) levels.push_back(l);
+            }
+        } catch (...) {
+            // Not a number: ignore this entry
+        }
+    }
+    return levels;
+}
+
+// Play every (seed, start level, script) match, spread over worker threads,
+// and report per-match results in seed order followed by overall throughput
+export void runHeadless(const HeadlessOptions& opt, ostream& out) {
+    struct Match {
+        int seed, level, script;
+        GameResult result;
+    };
+
+    vector<Match> matches;
+    for (int g = 0; g < opt.games; ++g) {
+        for (int level : opt.levels) {
+            for (int s = 0; s < static_cast<int>(opt.scripts.size()); ++s) {
+                matches.push_back(Match{opt.seed + g, level, s, GameResult{0, 0, 0, false}});
+            }
+        }
+    }
+
+    int threads = opt.threads > 0 ? opt.threads
+                                  : static_cast<int>(thread::hardware_concurrency());
+    if (threads <= 0) threads = 1;
+
+    long long totalCommands = 0;
+    auto start = chrono::steady_clock::now();
+
+    runWorkStealing(static_cast<int>(matches.size()), threads,
+        [&](int i) {
+            Match& m = matches[i];
+            m.result = playHeadless(opt.scripts[m.script].commands, m.seed, m.level,
+                                    opt.scriptFile1, opt.scriptFile2);
+        },
+        [&](int i) {
+            const Match& m = matches[i];
+            totalCommands += m.result.commands;
+            out << "match " << i << " (seed " << m.seed << ", level " << m.level
+                << ", script " << opt.scripts[m.script].name << "): Player 1: "
+                << m.result.score1 << ", Player 2: " << m.result.score2 << ", "
+                << m.result.commands << " commands, "
+                << (m.result.gameOver ? "game over" : "input ended") << '\n';
+        });
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (secs <= 0) secs = 1e-9;
+    out << "headless: " << matches.size() << " games on " << threads << " thread(s), "
+        << totalCommands << " commands in " << secs << " s ("
+        << matches.size() / secs << " games/sec, "
+        << totalCommands / secs << " commands/sec)" << endl;
+}
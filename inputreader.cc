@@ -0,0 +1,173 @@
+export module InputReader;
+
+import <string>;
+import <string_view>;
+import <vector>;
+import <cstring>;
+import <cerrno>;
+import <fcntl.h>;
+import <unistd.h>;
+import <sys/mman.h>;
+import <sys/stat.h>;
+import <poll.h>;
+
+// Reads lines or whitespace-separated words as string_views, without a
+// std::string per token. The source is one of:
+//   - text already in memory (viewed, not copied; it must outlive the reader)
+//   - a regular file, mapped into memory
+//   - a file descriptor such as stdin, read in large chunks
+// A view stays valid until the next read. Tokens that straddle two chunks
+// are moved to the front of the buffer before more is read, so a line such
+// as "norandom <file>" always comes back whole.
+export class InputReader {
+    static constexpr std::size_t ChunkSize = 64 * 1024;
+
+    const char* data = nullptr;  // unread input is data[begin, end)
+    std::size_t begin = 0, end = 0;
+
+    int fd = -1;                 // chunked source, -1 once exhausted or if none
+    bool ownsFd = false;
+    std::vector<char> buffer;    // chunk storage for fd sources
+
+    void* mapped = nullptr;      // mmap'd file, if any
+    std::size_t mappedSize = 0;
+
+    static bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    // Read more input after the unread bytes, keeping them in place at the
+    // front of the buffer; false when there is no more input
+    bool refill() {
+        if (fd < 0) return false;
+
+        std::size_t unread = end - begin;
+        if (begin > 0) {
+            std::memmove(buffer.data(), buffer.data() + begin, unread);
+            begin = 0;
+            end = unread;
+        }
+        if (buffer.size() - end < ChunkSize / 2) {
+            buffer.resize(buffer.size() * 2);  // one token longer than a chunk
+        }
+
+        ssize_t n;
+        do {
+            n = ::read(fd, buffer.data() + end, buffer.size() - end);
+        } while (n < 0 && errno == EINTR);
+
+        data = buffer.data();
+        if (n <= 0) {
+            release();
+            return false;
+        }
+        end += static_cast<std::size_t>(n);
+        return true;
+    }
+
+    void release() {
+        if (ownsFd && fd >= 0) ::close(fd);
+        fd = -1;
+        ownsFd = false;
+    }
+
+    void useFd(int source, bool owned) {
+        fd = source;
+        ownsFd = owned;
+        buffer.resize(ChunkSize);
+        data = buffer.data();
+        begin = end = 0;
+    }
+
+public:
+    // No input until open() succeeds
+    InputReader() = default;
+
+    // Read from a descriptor the caller keeps open (e.g. 0 for stdin)
+    explicit InputReader(int source) { useFd(source, false); }
+
+    // Read from text already in memory
+    explicit InputReader(std::string_view text) : data{text.data()}, end{text.size()} {}
+
+    ~InputReader() {
+        release();
+        if (mapped) ::munmap(mapped, mappedSize);
+    }
+
+    InputReader(const InputReader&) = delete;
+    InputReader& operator=(const InputReader&) = delete;
+
+    // Open a file, mapping it if it is a regular non-empty file and reading
+    // it in chunks otherwise (pipes, /dev/stdin). False if it cannot be opened.
+    bool open(const std::string& path) {
+        int source = ::open(path.c_str(), O_RDONLY);
+        if (source < 0) return false;
+
+        struct stat st;
+        if (::fstat(source, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ,
+                             MAP_PRIVATE, source, 0);
+            if (p != MAP_FAILED) {
+                ::close(source);
+                mapped = p;
+                mappedSize = static_cast<std::size_t>(st.st_size);
+                data = static_cast<const char*>(p);
+                begin = 0;
+                end = mappedSize;
+                return true;
+            }
+        }
+        useFd(source, true);
+        return true;
+    }
+
+    // Is more input available right now, so that the next read would not
+    // wait? True at end of input on a descriptor, since that read returns.
+    bool hasPendingInput() const {
+        if (begin < end) return true;
+        if (fd < 0) return false;
+        pollfd p{fd, POLLIN, 0};
+        return ::poll(&p, 1, 0) > 0;
+    }
+
+    // Next line without its '\n' (like getline); false at end of input
+    bool nextLine(std::string_view& line) {
+        std::size_t scanned = 0;
+        while (true) {
+            std::size_t avail = end - begin - scanned;
+            const void* nl = avail ? std::memchr(data + begin + scanned, '\n', avail) : nullptr;
+            if (nl) {
+                std::size_t len = static_cast<const char*>(nl) - (data + begin);
+                line = std::string_view(data + begin, len);
+                begin += len + 1;
+                return true;
+            }
+            scanned = end - begin;
+            if (!refill()) break;
+        }
+
+        // Last line, not terminated by '\n'
+        if (begin == end) return false;
+        line = std::string_view(data + begin, end - begin);
+        begin = end;
+        return true;
+    }
+
+    // Next whitespace-separated word (like operator>>); false at end of input
+    bool nextWord(std::string_view& word) {
+        while (true) {
+            while (begin < end && isSpace(data[begin])) ++begin;
+            if (begin < end) break;
+            if (!refill()) return false;
+        }
+
+        std::size_t len = 0;
+        while (true) {
+            while (begin + len < end && !isSpace(data[begin + len])) ++len;
+            if (begin + len < end || !refill()) break;
+        }
+        word = std::string_view(data + begin, len);
+        begin += len;
+        return true;
+    }
+};
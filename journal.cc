@@ -0,0 +1,306 @@
+export module Journal;
+
+import Board;
+import Block;
+import <array>;
+import <bit>;
+import <vector>;
+import <cstdint>;
+import <cstring>;
+
+// Undo history of a match: one small entry per command line, holding only
+// what the command changed. Each entry can be undone and redone in time
+// proportional to its size:
+//   - a locked block, with what its cells held before
+//   - rows a clear removed, with their cells' symbols and blocks
+//   - the rows holding cells before a restart
+//   - everything else (scores, levels, effects, blocks, random streams,
+//     turn) as the bytes of the match state that differ, XORed, so the
+//     same record steps either way
+//
+// A span [begin, end) of the bytes of a state
+export struct ByteRange {
+    std::size_t begin, end;
+};
+
+// Entries form a tree: a command after an undo starts a new branch instead
+// of discarding the old one, and redo follows whichever branch was chosen
+// last, so alternative lines can be explored from any position.
+export class Journal {
+    enum class Kind : std::uint8_t {
+        Lock,   // the Block and its level, then row, col, old CellRecord per cell
+        Rows,   // u32 fullRows() mask, then cols CellRecords per row, top first
+        Reset,  // as Rows, for the rows holding cells before Board::reset
+        State   // runs of u16 offset, u16 length, XORed bytes
+    };
+
+    struct Change {
+        Kind kind;
+        std::uint8_t player;
+        std::uint32_t offset;  // payload is data[offset, offset + size)
+        std::uint32_t size;
+    };
+
+    struct Entry {
+        std::uint32_t first, last;  // its changes[first, last)
+        std::int32_t parent;
+        std::int32_t next = -1;     // child that redo goes to
+        std::int32_t newest = -1;   // children, newest first,
+        std::int32_t older = -1;    //   linked through older
+    };
+
+    std::vector<Change> changes;
+    std::vector<std::uint8_t> data;
+    std::vector<Entry> entries{Entry{0, 0, -1}};  // entries[0]: where recording began
+    std::int32_t at = 0;                          // entry of the current position
+    bool recording = false;
+    std::uint32_t firstChange = 0;                // of the entry being recorded
+
+    static constexpr std::uint32_t LockHeader = sizeof(Block) + 1;
+    static constexpr std::uint32_t LockCell = 2 + sizeof(Board::CellRecord);
+
+    std::uint8_t* add(Kind kind, int player, std::size_t size) {
+        changes.push_back(Change{kind, static_cast<std::uint8_t>(player),
+                                 static_cast<std::uint32_t>(data.size()),
+                                 static_cast<std::uint32_t>(size)});
+        data.resize(data.size() + size);
+        return data.data() + changes.back().offset;
+    }
+
+    // A Rows or Reset record: the row mask, then every cell of those rows
+    void addRows(Kind kind, int player, const Board& b, std::uint32_t rows) {
+        int cols = b.numCols();
+        std::uint8_t* p = add(kind, player,
+                              4 + static_cast<std::size_t>(std::popcount(rows)) * cols * sizeof(Board::CellRecord));
+        std::memcpy(p, &rows, 4);
+        p += 4;
+        for (int r = 0; r < b.numRows(); ++r) {
+            if (!(rows & (1u << r))) continue;
+            for (int c = 0; c < cols; ++c) {
+                Board::CellRecord cell = b.cellRecord(r, c);
+                std::memcpy(p, &cell, sizeof cell);
+                p += sizeof cell;
+            }
+        }
+    }
+
+    // Apply one change forwards or backwards
+    void apply(const Change& c, bool forward, std::array<Board*, 2> boards, std::uint8_t* state) {
+        const std::uint8_t* p = data.data() + c.offset;
+        Board& b = *boards[c.player];
+        switch (c.kind) {
+            case Kind::Lock:
+                if (forward) {
+                    Block block;
+                    std::memcpy(static_cast<void*>(&block), p, sizeof(Block));
+                    b.lockBlock(block, p[sizeof(Block)]);
+                } else {
+                    for (std::uint32_t i = c.size; i > LockHeader; i -= LockCell) {
+                        Board::CellRecord cell;
+                        std::memcpy(&cell, p + i - LockCell + 2, sizeof cell);
+                        b.restoreCell(p[i - LockCell], p[i - LockCell + 1], cell);
+                    }
+                }
+                break;
+            case Kind::Rows:
+                if (forward) {
+                    b.clearFullRows();
+                } else {
+                    std::uint32_t cleared;
+                    std::memcpy(&cleared, p, 4);
+                    std::array<Board::CellRecord, Board::MaxRows * Board::MaxCols> cells;
+                    std::memcpy(cells.data(), p + 4, c.size - 4);
+                    b.restoreRows(cleared, cells.data());
+                }
+                break;
+            case Kind::Reset:
+                if (forward) {
+                    b.reset();
+                } else {
+                    // Cell by cell into the empty board
+                    std::uint32_t rows;
+                    std::memcpy(&rows, p, 4);
+                    p += 4;
+                    for (int r = 0; r < b.numRows(); ++r) {
+                        if (!(rows & (1u << r))) continue;
+                        for (int col = 0; col < b.numCols(); ++col) {
+                            Board::CellRecord cell;
+                            std::memcpy(&cell, p, sizeof cell);
+                            p += sizeof cell;
+                            b.restoreCell(r, col, cell);
+                        }
+                    }
+                }
+                break;
+            case Kind::State:
+                for (std::uint32_t i = 0; i < c.size;) {
+                    std::uint16_t off, len;
+                    std::memcpy(&off, p + i, 2);
+                    std::memcpy(&len, p + i + 2, 2);
+                    i += 4;
+                    for (std::uint16_t k = 0; k < len; ++k) state[off + k] ^= p[i + k];
+                    i += len;
+                }
+                break;
+        }
+    }
+
+    // Append the XORed runs where a and b differ within r; the number of runs
+    std::size_t diff(const std::uint8_t* a, const std::uint8_t* b, ByteRange r) {
+        std::size_t runs = 0;
+        for (std::size_t i = r.begin; i < r.end;) {
+            if (i + 8 <= r.end && std::memcmp(a + i, b + i, 8) == 0) {
+                i += 8;
+                continue;
+            }
+            if (a[i] == b[i]) {
+                ++i;
+                continue;
+            }
+            // One run spans gaps too short to be worth another run header
+            std::size_t last = i;
+            for (std::size_t k = i + 1; k < r.end && k - last <= 4; ++k) {
+                if (a[k] != b[k]) last = k;
+            }
+            std::size_t end = last + 1;
+            std::uint16_t off = static_cast<std::uint16_t>(i), len = static_cast<std::uint16_t>(end - i);
+            std::size_t p = data.size();
+            data.resize(p + 4 + len);
+            std::memcpy(&data[p], &off, 2);
+            std::memcpy(&data[p + 2], &len, 2);
+            for (std::size_t k = i; k < end; ++k) data[p + 4 + (k - i)] = a[k] ^ b[k];
+            ++runs;
+            i = end;
+        }
+        return runs;
+    }
+
+public:
+    // Forget all history; the current position becomes the root
+    void clear() {
+        changes.clear();
+        data.clear();
+        entries.assign(1, Entry{0, 0, -1});
+        at = 0;
+        recording = false;
+    }
+
+    // Recording one entry. Board changes are reported just before they are
+    // made; commit() then adds the rest of the state as a diff of its bytes.
+    // Reports outside begin()/commit() are ignored.
+    void begin() {
+        recording = true;
+        firstChange = static_cast<std::uint32_t>(changes.size());
+    }
+
+    // Before Board::lockBlock
+    void locking(int player, const Board& b, const Block& block, int level) {
+        if (!recording) return;
+        CellView cells = block.getAbsoluteCells();
+        int n = 0;
+        for (const Position& pos : cells) {
+            if (pos.row >= 0 && pos.row < b.numRows() && pos.col >= 0 && pos.col < b.numCols()) ++n;
+        }
+        if (n == 0) return;
+        std::uint8_t* p = add(Kind::Lock, player, LockHeader + LockCell * n);
+        std::memcpy(p, static_cast<const void*>(&block), sizeof(Block));
+        p[sizeof(Block)] = static_cast<std::uint8_t>(level);
+        p += LockHeader;
+        for (const Position& pos : cells) {
+            if (pos.row < 0 || pos.row >= b.numRows() || pos.col < 0 || pos.col >= b.numCols()) continue;
+            Board::CellRecord old = b.cellRecord(pos.row, pos.col);
+            *p++ = static_cast<std::uint8_t>(pos.row);
+            *p++ = static_cast<std::uint8_t>(pos.col);
+            std::memcpy(p, &old, sizeof old);
+            p += sizeof old;
+        }
+    }
+
+    // Before Board::clearFullRows
+    void clearing(int player, const Board& b) {
+        std::uint32_t full = b.fullRows();
+        if (recording && full != 0) addRows(Kind::Rows, player, b, full);
+    }
+
+    // Before Board::reset
+    void resetting(int player, const Board& b) {
+        std::uint32_t used = 0;
+        for (int r = 0; r < b.numRows(); ++r) {
+            if (b.rowMask(r) != 0) used |= 1u << r;
+        }
+        if (recording && used != 0) addRows(Kind::Reset, player, b, used);
+    }
+
+    // Finish the entry, given the rest of the match state before and after
+    // (at most 64KB each). Only the bytes in `ranges` are compared: the
+    // parts the board records already cover are left out. The entry
+    // becomes the newest child of the position it was recorded from.
+    template <std::size_t N>
+    void commit(const void* before, const void* after, const std::array<ByteRange, N>& ranges) {
+        recording = false;
+        std::uint32_t offset = static_cast<std::uint32_t>(data.size());
+        std::size_t runs = 0;
+        for (const ByteRange& r : ranges) {
+            runs += diff(static_cast<const std::uint8_t*>(before), static_cast<const std::uint8_t*>(after), r);
+        }
+        if (runs > 0) {
+            changes.push_back(Change{Kind::State, 0, offset, static_cast<std::uint32_t>(data.size() - offset)});
+        }
+        if (changes.size() == firstChange) return;  // nothing changed
+
+        Entry e{firstChange, static_cast<std::uint32_t>(changes.size()), at};
+        e.older = entries[at].newest;
+        std::int32_t id = static_cast<std::int32_t>(entries.size());
+        entries.push_back(e);
+        entries[at].newest = entries[at].next = id;
+        at = id;
+    }
+
+    // Step back over the current entry: boards change in place and the rest
+    // of the state is updated in `state` (laid out as given to commit).
+    // False at the root.
+    bool undo(std::array<Board*, 2> boards, void* state) {
+        if (at == 0) return false;
+        const Entry& e = entries[at];
+        for (std::uint32_t i = e.last; i > e.first; --i) {
+            apply(changes[i - 1], false, boards, static_cast<std::uint8_t*>(state));
+        }
+        entries[e.parent].next = at;  // redo comes back this way
+        at = e.parent;
+        return true;
+    }
+
+    // Step forward into the chosen branch; false if there is none
+    bool redo(std::array<Board*, 2> boards, void* state) {
+        std::int32_t n = entries[at].next;
+        if (n < 0) return false;
+        const Entry& e = entries[n];
+        for (std::uint32_t i = e.first; i < e.last; ++i) {
+            apply(changes[i], true, boards, static_cast<std::uint8_t*>(state));
+        }
+        at = n;
+        return true;
+    }
+
+    // Make redo take the next older branch from here (wrapping to the
+    // newest). Sets which (1 = newest) and of how many; false if there are
+    // fewer than two.
+    bool branch(int& which, int& count) {
+        Entry& e = entries[at];
+        count = 0;
+        for (std::int32_t c = e.newest; c >= 0; c = entries[c].older) ++count;
+        if (count < 2) return false;
+        e.next = entries[e.next].older >= 0 ? entries[e.next].older : e.newest;
+        which = 1;
+        for (std::int32_t c = e.newest; c != e.next; c = entries[c].older) ++which;
+        return true;
+    }
+
+    bool canUndo() const { return at != 0; }
+    bool canRedo() const { return entries[at].next >= 0; }
+
+    // Memory held, for diagnostics
+    std::size_t bytes() const {
+        return data.size() + changes.size() * sizeof(Change) + entries.size() * sizeof(Entry);
+    }
+};
@@ -1,19 +1,96 @@
 export module Level;
 
 import Block;
-import <memory>;
+import Random;
 import <string>;
+import <string_view>;
+import <array>;
+import <cstdint>;
+import <deque>;
+import <fstream>;
+import <vector>;
+
+// Where a level is in its piece stream, for snapshots of a match. Random
+// draws come from the player's Rng and files are named, not stored (see
+// NoRandomFiles), so neither is part of it. Fixed-size and trivially copyable, like the rest
+// of MatchState.
+export struct LevelState {
+    static constexpr std::size_t MaxFileName = 255;
+
+    std::uint32_t fileIndex = 0;         // Level0 sequence, Level3/4 norandom file
+    std::int32_t blocksSinceClear = 0;   // Level4
+    bool starPending = false;            // Level4
+    bool noRandom = false;               // Level3/4
+    std::array<char, MaxFileName + 1> noRandomFile{};  // Level3/4, NUL-terminated
+
+    std::string_view file() const { return noRandomFile.data(); }
+
+    // False, storing nothing, if the name does not fit
+    bool setFile(std::string_view name) {
+        if (name.size() > MaxFileName) return false;
+        noRandomFile.fill('\0');
+        name.copy(noRandomFile.data(), name.size());
+        return true;
+    }
+};
+
+// A sequence file read for norandom, by name
+export struct NoRandomFile {
+    std::string name;
+    std::vector<char> sequence;  // first letter of each word
+};
+
+// Every norandom file a level has read. A file is read by the norandom
+// command and kept, so restoring a snapshot or stepping through undo
+// history switches back to it without touching the disk. Only a snapshot
+// naming a file this level has never read (one from another run) makes
+// it read one.
+export class NoRandomFiles {
+    std::deque<NoRandomFile> files;  // a deque, so references stay valid
+
+    static void read(NoRandomFile& f) {
+        f.sequence.clear();
+        std::ifstream ifs(f.name);
+        std::string token;
+        while (ifs >> token) {
+            f.sequence.push_back(token[0]);
+        }
+    }
+
+public:
+    // Read a file, again if it was read before
+    const NoRandomFile& load(const std::string& name) {
+        for (NoRandomFile& f : files) {
+            if (f.name == name) {
+                read(f);
+                return f;
+            }
+        }
+        files.push_back(NoRandomFile{name, {}});
+        read(files.back());
+        return files.back();
+    }
+
+    // A file as it was last read, reading it only if it never was
+    const NoRandomFile& get(std::string_view name) {
+        for (const NoRandomFile& f : files) {
+            if (f.name == name) return f;
+        }
+        return load(std::string{name});
+    }
+};
 
 export class Level {
 protected:
     int levelNum;
+    Rng* rng;  // owned by the Player; levels only draw from it
 
 public:
-    Level(int n = 0) : levelNum{n} {}
+    Level(int n, Rng& r) : levelNum{n}, rng{&r} {}
 
     virtual ~Level() = default;
 
-    virtual std::unique_ptr<Block> nextBlock() = 0;
+    virtual Block nextBlock() = 0;
 
     virtual void onBlockLocked(int rowsCleared) {
         (void)rowsCleared;  // Default: do nothing
@@ -34,4 +111,8 @@ public:
 
     virtual bool shouldDropStar() { return false; }
     virtual void clearStarPending() {}
+
+    // Snapshot support; stateless levels keep the defaults
+    virtual void saveState(LevelState& s) const { s = LevelState{}; }
+    virtual void restoreState(const LevelState& s) { (void)s; }
 };
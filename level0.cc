@@ -2,12 +2,12 @@ export module Level0;
 
 import Level;
 import Block;
-import Blocks;
-import <memory>;
+import Random;
 import <string>;
 import <vector>;
 import <fstream>;
 import <sstream>;
+import <cstdint>;
 
 export class Level0: public Level{
     std::string filename;
@@ -35,11 +35,11 @@ export class Level0: public Level{
     }
 
     public:
-    Level0(const std::string &file = "sequence.txt") :Level{0}, filename{file}, idx(0) {loadFile();}
+    Level0(Rng& r, const std::string &file = "sequence.txt") :Level{0, r}, filename{file}, idx(0) {loadFile();}
 
-    std::unique_ptr<Block> nextBlock() override {
+    Block nextBlock() override {
         if (seq.empty()) loadFile();
-        if(seq.empty()) return std::make_unique<TBlock>(); // just for safety
+        if(seq.empty()) return makeBlock('T'); // just for safety
 
         char ch = seq[idx++];
 
@@ -47,15 +47,16 @@ export class Level0: public Level{
             idx = 0;    // rewind
         }
 
-        switch (ch){
-            case 'I': return std::make_unique<IBlock>();
-            case 'J': return std::make_unique<JBlock>();
-            case 'L': return std::make_unique<LBlock>();
-            case 'O': return std::make_unique<OBlock>();
-            case 'S': return std::make_unique<SBlock>();
-            case 'Z': return std::make_unique<ZBlock>();
-            case 'T': return std::make_unique<TBlock>();
-            default:  return std::make_unique<TBlock>();
-        }
+        // Unknown letters fall back to a T block
+        return makeBlock(isTetromino(ch) ? ch : 'T');
+    }
+
+    void saveState(LevelState& s) const override {
+        s = LevelState{};
+        s.fileIndex = static_cast<std::uint32_t>(idx);
+    }
+
+    void restoreState(const LevelState& s) override {
+        idx = s.fileIndex < seq.size() ? s.fileIndex : 0;
     }
 };
@@ -2,24 +2,14 @@ export module Level2;
 
 import Level;
 import Block;
-import Blocks;
-import <memory>;
-import <cstdlib>;
+import Random;
 
 export class Level2 : public Level {
 public:
-    Level2() : Level(2) {}
+    Level2(Rng& r) : Level(2, r) {}
 
-    std::unique_ptr<Block> nextBlock() override {
-        int r = rand() % 7;
-        switch (r) {
-            case 0: return std::make_unique<IBlock>();
-            case 1: return std::make_unique<JBlock>();
-            case 2: return std::make_unique<LBlock>();
-            case 3: return std::make_unique<OBlock>();
-            case 4: return std::make_unique<SBlock>();
-            case 5: return std::make_unique<ZBlock>();
-            default:return std::make_unique<TBlock>();
-        }
+    // Uniform over the seven blocks
+    Block nextBlock() override {
+        return makeBlock("IJLOSZT"[rng->below(7)]);
     }
 };
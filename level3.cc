@@ -2,79 +2,70 @@ export module Level3;
 
 import Level;
 import Block;
-import Blocks;
-import <memory>;
+import Random;
 import <vector>;
-import <cstdlib>;
 import <string>;
-import <fstream>;
+import <cstdint>;
 
 export class Level3 : public Level {
     std::vector<char> pool;
     
-    // For norandom mode
+    // For norandom mode; noRandomFile stays set (and loaded) after
+    // setRandom, so a restore can switch straight back to it
     bool useNoRandom;
-    std::string noRandomFile;
-    std::vector<char> fileSequence;
+    NoRandomFiles files;
+    const NoRandomFile* noRandomFile = nullptr;
     size_t fileIndex;
-    
-    void loadSequenceFile() {
-        fileSequence.clear();
-        fileIndex = 0;
-        
-        std::ifstream ifs(noRandomFile);
-        if (!ifs) return;
-        
-        std::string token;
-        while (ifs >> token) {
-            if (!token.empty()) {
-                fileSequence.push_back(token[0]);
-            }
-        }
-    }
 
 public:
-    Level3() : Level(3), useNoRandom{false}, fileIndex{0} {
+    Level3(Rng& r) : Level(3, r), useNoRandom{false}, fileIndex{0} {
         // S and Z have probability 2/9 each, others have 1/9 each
         pool = {'S', 'S', 'Z', 'Z', 'I', 'J', 'L', 'O', 'T'};
     }
 
-    std::unique_ptr<Block> nextBlock() override {
+    Block nextBlock() override {
         char ch;
         
-        if (useNoRandom && !fileSequence.empty()) {
-            ch = fileSequence[fileIndex++];
-            if (fileIndex >= fileSequence.size()) {
+        if (useNoRandom && !noRandomFile->sequence.empty()) {
+            ch = noRandomFile->sequence[fileIndex++];
+            if (fileIndex >= noRandomFile->sequence.size()) {
                 fileIndex = 0;  // Wrap around
             }
         } else {
-            int idx = rand() % static_cast<int>(pool.size());
+            int idx = rng->below(static_cast<int>(pool.size()));
             ch = pool[idx];
         }
         
-        switch (ch) {
-            case 'I': return std::make_unique<IBlock>();
-            case 'J': return std::make_unique<JBlock>();
-            case 'L': return std::make_unique<LBlock>();
-            case 'O': return std::make_unique<OBlock>();
-            case 'S': return std::make_unique<SBlock>();
-            case 'Z': return std::make_unique<ZBlock>();
-            case 'T': return std::make_unique<TBlock>();
-            default:  return std::make_unique<TBlock>();
-        }
+        // Unknown letters fall back to a T block
+        return makeBlock(isTetromino(ch) ? ch : 'T');
     }
 
     bool isHeavy() const override { return true; }
     
     void setNoRandom(const std::string& filename) override {
         useNoRandom = true;
-        noRandomFile = filename;
-        loadSequenceFile();
+        noRandomFile = &files.load(filename);
+        fileIndex = 0;
     }
     
     void setRandom() override {
         useNoRandom = false;
-        fileSequence.clear();
         fileIndex = 0;
     }
+
+    void saveState(LevelState& s) const override {
+        s = LevelState{};
+        s.fileIndex = static_cast<std::uint32_t>(fileIndex);
+        s.noRandom = useNoRandom;
+        if (useNoRandom) s.setFile(noRandomFile->name);
+    }
+
+    // Switches to the norandom file as already read (see NoRandomFiles)
+    void restoreState(const LevelState& s) override {
+        useNoRandom = s.noRandom;
+        if (useNoRandom && (!noRandomFile || noRandomFile->name != s.file())) {
+            noRandomFile = &files.get(s.file());
+        }
+        fileIndex = useNoRandom && s.fileIndex < noRandomFile->sequence.size() ? s.fileIndex : 0;
+    }
 };
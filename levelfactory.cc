@@ -6,6 +6,7 @@ import Level1;
 import Level2;
 import Level3;
 import Level4;
+import Random;
 
 import <memory>;
 import <string>;
@@ -15,22 +16,23 @@ import <string>;
 // The caller (Player) should pass the correct sequence file.
 // If empty, Level0 will use its own default ("sequence.txt")
 
-export std::unique_ptr<Level> makeLevel(int levelNumber, const std::string& seqFile = "") {
+// Levels 1-4 draw their random pieces from rng, which the caller owns.
+export std::unique_ptr<Level> makeLevel(int levelNumber, Rng& rng, const std::string& seqFile = "") {
     switch (levelNumber) {
         case 0: 
             // If sequence file provided, use it; otherwise Level0 uses its default
             if (!seqFile.empty()) {
-                return std::make_unique<Level0>(seqFile);
+                return std::make_unique<Level0>(rng, seqFile);
             }
-            return std::make_unique<Level0>();
-        case 1: return std::make_unique<Level1>();
-        case 2: return std::make_unique<Level2>();
-        case 3: return std::make_unique<Level3>();
-        case 4: return std::make_unique<Level4>();
+            return std::make_unique<Level0>(rng);
+        case 1: return std::make_unique<Level1>(rng);
+        case 2: return std::make_unique<Level2>(rng);
+        case 3: return std::make_unique<Level3>(rng);
+        case 4: return std::make_unique<Level4>(rng);
         default: 
             if (!seqFile.empty()) {
-                return std::make_unique<Level0>(seqFile);
+                return std::make_unique<Level0>(rng, seqFile);
             }
-            return std::make_unique<Level0>();
+            return std::make_unique<Level0>(rng);
     }
 }
@@ -4,25 +4,52 @@ import Player;
 import IDisplay;
 import TextDisplay;
 import GraphicDisplay;
+import AsyncDisplay;
+import Headless;
+import Replay;
+import ReplaySession;
+import Journal;
 import <iostream>;
+import <fstream>;
+import <sstream>;
 import <string>;
-import <cstdlib>;
+import <vector>;
+import <memory>;
 
 using namespace std;
 
 int main(int argc, char* argv[]) {
     bool textOnly = false;
+    bool ansi = false;
+    bool syncRender = false;
+    RenderPolicy renderPolicy = RenderPolicy::EveryCommand;
+    int maxFps = 30;
     int seed = 0;
     string scriptFile1 = "biquadris_sequence1.txt";
     
     string scriptFile2 = "biquadris_sequence2.txt";
     int startLevel = 0;
+    int headlessGames = 0;
+    int threads = 0;
+    string levelList;
+    vector<string> commandFiles;
+    vector<string> aliases;
+    string recordFile;
+    string replayFile;
+    long long seekMove = -1;
 
     for (int i = 1; i < argc; ++i) {
         string args = argv[i];
 
         if (args == "-text") {
             textOnly = true;
+        } else if (args == "-ansi") {
+            // Text display that redraws only what changed (implies -text)
+            textOnly = true;
+            ansi = true;
+        } else if (args == "-sync") {
+            // Draw the graphical display on the game thread
+            syncRender = true;
         } else if (args == "-seed") {
             if (i + 1 < argc) {
                 seed = stoi(argv[++i]);
@@ -41,12 +68,107 @@ int main(int argc, char* argv[]) {
                 if (startLevel < 0) startLevel = 0;
                 if (startLevel > 4) startLevel = 4;
             }
+        } else if (args == "-headless") {
+            if (i + 1 < argc) {
+                headlessGames = stoi(argv[++i]);
+            }
+        } else if (args == "-commands") {
+            if (i + 1 < argc) {
+                commandFiles.push_back(argv[++i]);
+            }
+        } else if (args == "-threads") {
+            if (i + 1 < argc) {
+                threads = stoi(argv[++i]);
+            }
+        } else if (args == "-levels") {
+            if (i + 1 < argc) {
+                levelList = argv[++i];
+            }
+        } else if (args == "-render") {
+            // every | turn | final | auto | <max frames per second>
+            if (i + 1 < argc) {
+                string mode = argv[++i];
+                if (mode == "every") renderPolicy = RenderPolicy::EveryCommand;
+                else if (mode == "turn") renderPolicy = RenderPolicy::TurnBoundary;
+                else if (mode == "final") renderPolicy = RenderPolicy::FinalOnly;
+                else if (mode == "auto") renderPolicy = RenderPolicy::Auto;
+                else {
+                    try {
+                        maxFps = stoi(mode);
+                        renderPolicy = RenderPolicy::MaxFps;
+                    } catch (...) {
+                        cerr << "Unknown render mode " << mode << ".\n";
+                    }
+                }
+            }
+        } else if (args == "-record") {
+            if (i + 1 < argc) {
+                recordFile = argv[++i];
+            }
+        } else if (args == "-replay") {
+            if (i + 1 < argc) {
+                replayFile = argv[++i];
+            }
+        } else if (args == "-seek") {
+            // With -replay: show the state after this many commands
+            if (i + 1 < argc) {
+                seekMove = stoll(argv[++i]);
+            }
+        } else if (args == "-alias") {
+            if (i + 1 < argc) {
+                aliases.push_back(argv[++i]);
+            }
         }
     }
 
-    // Set random seed if provided
-    if (seed != 0) {
-        srand(seed);
+    // Re-execute a recorded match and check its final scores
+    if (!replayFile.empty() && seekMove < 0) {
+        return verifyReplay(replayFile, cout) ? 0 : 1;
+    }
+
+    // Show a recorded match after a given number of commands
+    if (!replayFile.empty()) {
+        ReplaySession session;
+        if (!session.open(replayFile) || !session.seek(seekMove)) {
+            cout << "replay: " << session.error() << endl;
+            return 1;
+        }
+        Frame frame;
+        frame.capture(session.player(0), session.player(1));
+        TextDisplay().render(frame);
+        cout << "Command " << session.position() << " of " << session.length() << endl;
+        return 0;
+    }
+
+    // Headless batch mode: no display, commands from in-memory scripts,
+    // every seed x start level x script match spread over worker threads
+    if (headlessGames > 0) {
+        HeadlessOptions opt;
+        opt.games = headlessGames;
+        opt.seed = seed;
+        opt.levels = levelList.empty() ? vector<int>{startLevel} : parseLevelList(levelList);
+        opt.threads = threads;
+        opt.scriptFile1 = scriptFile1;
+        opt.scriptFile2 = scriptFile2;
+
+        if (commandFiles.empty()) {
+            ostringstream script;
+            script << cin.rdbuf();
+            opt.scripts.push_back(CommandScript{"stdin", script.str()});
+        }
+        for (const string& name : commandFiles) {
+            ifstream file(name);
+            if (!file) {
+                cerr << "Could not open command file " << name << ".\n";
+                return 1;
+            }
+            ostringstream script;
+            script << file.rdbuf();
+            opt.scripts.push_back(CommandScript{name, script.str()});
+        }
+
+        runHeadless(opt, cout);
+        return 0;
     }
 
     // Pass script files to players
@@ -55,16 +177,38 @@ int main(int argc, char* argv[]) {
 
     CommandInterpreter* ci = new CommandInterpreter();
 
+    // -alias name=command, e.g. -alias l=left
+    for (const string& alias : aliases) {
+        size_t eq = alias.find('=');
+        if (eq == string::npos || !ci->addAlias(alias.substr(0, eq), alias.substr(eq + 1))) {
+            cerr << "Invalid alias " << alias << ", expected name=command.\n";
+        }
+    }
+
     IDisplay *display;
 
     if (textOnly) {
-        display = new TextDisplay();
-    } else {
+        display = new TextDisplay(ansi);
+    } else if (syncRender) {
         display = new GraphicDisplay();
+    } else {
+        // Draw on a separate thread so a slow X server does not hold up input
+        display = new AsyncDisplay(make_unique<GraphicDisplay>());
     }
 
 
     GameController* gc = new GameController(p1, p2, ci, seed, display);
+    gc->setRenderPolicy(renderPolicy, maxFps);
+
+    // Undo history for the undo/redo/branch commands
+    Journal journal;
+    gc->setJournal(&journal);
+
+    unique_ptr<ReplayWriter> recorder;
+    if (!recordFile.empty()) {
+        recorder = make_unique<ReplayWriter>(recordFile, seed, startLevel, scriptFile1, scriptFile2);
+        gc->setRecorder(recorder.get());
+    }
 
     gc->startNewGame(startLevel);
 
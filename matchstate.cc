@@ -0,0 +1,161 @@
+export module MatchState;
+
+import Player;
+import <array>;
+import <bit>;
+import <cstdint>;
+import <cstdio>;
+import <cstring>;
+import <string>;
+import <type_traits>;
+import <cerrno>;
+import <fcntl.h>;
+import <unistd.h>;
+import <sys/mman.h>;
+import <sys/stat.h>;
+
+// Everything that changes during a match: both players plus the controller's
+// turn and match-wide counters. GameController::snapshot/restore move a
+// match in and out of one; replay keyframes store one.
+//
+// It is a fixed-size block of plain data (boards, blocks and random streams
+// are all held inline, file names in fixed arrays), so taking or copying a
+// snapshot is a memcpy and never allocates.
+export struct MatchState {
+    std::array<PlayerState, 2> players;
+    std::int32_t current = 0;              // whose turn: 0 = player 1, 1 = player 2
+    std::int32_t hiScore = 0;
+    bool gameOver = false;
+    std::int64_t commandsExecuted = 0;
+};
+
+static_assert(std::is_trivially_copyable_v<MatchState> && std::is_standard_layout_v<MatchState>);
+
+// Snapshot files: a 24-byte header followed by the MatchState bytes exactly
+// as they are in memory, so a mapped file can be used in place. The layout
+// is that of a little-endian machine with 32-bit int; any change to it must
+// bump SnapshotVersion (the size check below catches most).
+//
+//   magic "BQMS" | u32 version | u32 size of MatchState | u32 reserved (0)
+//   | u64 FNV-1a hash of the state bytes | state
+//
+// Padding bytes inside the state are whatever the writer's memory held.
+export inline constexpr std::uint32_t SnapshotVersion = 2;
+
+static_assert(std::endian::native == std::endian::little && sizeof(int) == 4);
+static_assert(sizeof(MatchState) == 6200 && alignof(MatchState) == 8,
+              "MatchState layout changed: bump SnapshotVersion and update this check");
+
+struct SnapshotHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t size;
+    std::uint32_t reserved;
+    std::uint64_t hash;
+};
+
+static_assert(sizeof(SnapshotHeader) % alignof(MatchState) == 0);
+
+constexpr char SnapshotMagic[4] = {'B', 'Q', 'M', 'S'};
+
+std::uint64_t hashBytes(const void* data, std::size_t n) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    std::uint64_t h = 0xCBF29CE484222325ull;
+    for (std::size_t i = 0; i < n; ++i) {
+        h = (h ^ p[i]) * 0x100000001B3ull;
+    }
+    return h;
+}
+
+// The state stored in a snapshot file's bytes (e.g. a mapping of it), used
+// in place; nullptr if they are not a complete, intact snapshot of this
+// version. data must be 8-byte aligned, as mappings are.
+export const MatchState* snapshotView(const void* data, std::size_t size) {
+    if (size != sizeof(SnapshotHeader) + sizeof(MatchState)) return nullptr;
+    if (reinterpret_cast<std::uintptr_t>(data) % alignof(MatchState) != 0) return nullptr;
+
+    SnapshotHeader h;
+    std::memcpy(&h, data, sizeof h);
+    if (std::memcmp(h.magic, SnapshotMagic, 4) != 0 || h.version != SnapshotVersion ||
+        h.size != sizeof(MatchState)) {
+        return nullptr;
+    }
+    const unsigned char* state = static_cast<const unsigned char*>(data) + sizeof h;
+    if (hashBytes(state, sizeof(MatchState)) != h.hash) return nullptr;
+    return reinterpret_cast<const MatchState*>(state);
+}
+
+// Write `size` bytes as the file at path. They go to a file beside it that
+// is synced and renamed over it once complete, so a crash never leaves a
+// torn file behind; false (and no temporary left) if any step fails.
+export bool writeFileAtomic(const std::string& path, const void* data, std::size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    std::size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::write(fd, bytes + done, size - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += static_cast<std::size_t>(n);
+    }
+    bool ok = done == size && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (ok && std::rename(tmp.c_str(), path.c_str()) == 0) return true;
+    ::unlink(tmp.c_str());
+    return false;
+}
+
+// Write a snapshot file (see writeFileAtomic)
+export bool saveSnapshot(const std::string& path, const MatchState& s) {
+    SnapshotHeader h{};
+    std::memcpy(h.magic, SnapshotMagic, 4);
+    h.version = SnapshotVersion;
+    h.size = sizeof(MatchState);
+    h.hash = hashBytes(&s, sizeof s);
+
+    std::array<unsigned char, sizeof(SnapshotHeader) + sizeof(MatchState)> bytes;
+    std::memcpy(bytes.data(), &h, sizeof h);
+    std::memcpy(bytes.data() + sizeof h, &s, sizeof s);
+    return writeFileAtomic(path, bytes.data(), bytes.size());
+}
+
+// A snapshot file mapped read-only; state() points into the mapping
+export class SnapshotFile {
+    void* mapped = nullptr;
+    std::size_t mappedSize = 0;
+    const MatchState* view = nullptr;
+
+public:
+    SnapshotFile() = default;
+
+    ~SnapshotFile() {
+        if (mapped) ::munmap(mapped, mappedSize);
+    }
+
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    // False if the file cannot be mapped or is not a valid snapshot
+    bool open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        void* p = MAP_FAILED;
+        if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+
+        if (mapped) ::munmap(mapped, mappedSize);
+        mapped = p;
+        mappedSize = static_cast<std::size_t>(st.st_size);
+        view = snapshotView(mapped, mappedSize);
+        return view != nullptr;
+    }
+
+    const MatchState& state() const { return *view; }
+};
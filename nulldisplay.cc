@@ -0,0 +1,16 @@
+export module NullDisplay;
+
+import Player;
+import IDisplay;
+import <string>;
+
+using namespace std;
+
+// Display for headless runs: draws nothing and asks the controller not to
+// format messages at all
+export class NullDisplay : public IDisplay {
+public:
+    void message(const string& s) override { (void)s; }
+    void render(const Frame& frame) override { (void)frame; }
+    bool wantsMessages() const override { return false; }
+};
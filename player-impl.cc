@@ -1,56 +1,68 @@
 module Player;
 
-import <cstdlib>;
+import <array>;
 import <memory>;
 import <string>;
 import <vector>;
 import Board;
 import Block;
-import Blocks;
 import Level;
 import LevelFactory;
+import Random;
+import Journal;
 
 Player::Player()
     : playerScore{0}
     , playerLevel{0}
-    , theirBoard{nullptr}
-    , currentBlock{nullptr}
-    , nextBlock{nullptr}
+    , theirBoard{}
+    , currentBlock{}
+    , nextBlock{}
+    , rng{}
     , levelObj{nullptr}
-    , lastLockedBlockType{' '}
     , currentBlockLevel{0}
-    , lastLockedPositions{}
     , heavyEffect{false}
     , blindEffect{false}
     , sequenceFile{""}
 {
-    theirBoard = new Board();
-    levelObj = makeLevel(0, "");
+    levelObj = enterLevel(0);
 }
 
 // Constructor now accepts and stores sequence file
 Player::Player(int startLevel, const std::string& seqFile) 
     : playerScore{0}
     , playerLevel{startLevel}
-    , theirBoard{nullptr}
-    , currentBlock{nullptr}
-    , nextBlock{nullptr}
+    , theirBoard{}
+    , currentBlock{}
+    , nextBlock{}
+    , rng{}
     , levelObj{nullptr}
-    , lastLockedBlockType{' '}
     , currentBlockLevel{0}
-    , lastLockedPositions{}
     , heavyEffect{false}
     , blindEffect{false}
     , sequenceFile{seqFile}
 {
-    theirBoard = new Board();
-    // Pass sequence file to makeLevel
-    levelObj = makeLevel(startLevel, sequenceFile);
+    levelObj = enterLevel(startLevel);
 }
 
 
-Player::~Player() {
-    delete theirBoard;
+Player::~Player() = default;
+
+// The object for a level (levels outside 0-4 play as level 0), made on
+// first use and kept
+Level* Player::levelFor(int level) {
+    if (level < 0 || level > 4) level = 0;
+    if (!levels[level]) {
+        // Pass sequence file to makeLevel
+        levels[level] = makeLevel(level, rng, sequenceFile);
+    }
+    return levels[level].get();
+}
+
+// The object for a level, in the state a newly made one starts in
+Level* Player::enterLevel(int level) {
+    Level* l = levelFor(level);
+    l->restoreState(LevelState{});
+    return l;
 }
 
 // Getters
@@ -63,15 +75,15 @@ int Player::getScore() const {
 }
 
 Block* Player::getCurrentBlock() {
-    return currentBlock.get();
+    return currentBlock.empty() ? nullptr : &currentBlock;
 }
 
 Block* Player::getNextBlock() {
-    return nextBlock.get();
+    return nextBlock.empty() ? nullptr : &nextBlock;
 }
 
 Board& Player::getBoard() {
-    return *theirBoard;
+    return theirBoard;
 }
 
 bool Player::hasHeavyEffect() const {
@@ -87,16 +99,21 @@ bool Player::hasBlindEffect() const {
 void Player::setLevel(int level) {
     if (level >= 0 && level <= 4) {
         playerLevel = level;
-        levelObj = makeLevel(level, sequenceFile);
+        levelObj = enterLevel(level);
     }
 }
 
+// Replace this player's piece stream (e.g. with its stream of a match seed)
+void Player::setRng(const Rng& stream) {
+    rng = stream;
+}
+
 // Block generation using Level objects
-std::unique_ptr<Block> Player::generateBlock() {
+Block Player::generateBlock() {
     if (levelObj) {
         return levelObj->nextBlock();
     }
-    return std::make_unique<TBlock>();
+    return makeBlock('T');
 }
 
 void Player::spawnInitialBlocks() {
@@ -106,7 +123,7 @@ void Player::spawnInitialBlocks() {
 }
 
 void Player::spawnNextBlock() {
-    currentBlock = std::move(nextBlock);
+    currentBlock = nextBlock;
     currentBlockLevel = playerLevel;  // The next block becomes current, track its level
     nextBlock = generateBlock();
     
@@ -118,22 +135,18 @@ void Player::spawnNextBlock() {
  * lockCurrentBlock() - Locks the current block onto the board
  * 
  * Steps:
- * 1. Get the absolute cell positions of the current block
- * 2. Save these positions (needed for checkAndScoreCompletedBlocks)
- * 3. Lock the block onto the board grid
- * 4. Clear any full rows
- * 5. Notify level object (for Level 4 star block logic)
- * 6. Return number of rows cleared
+ * 1. Lock the block onto the board grid, tagged with the level it was made at
+ * 2. Clear any full rows, scoring every block they removed the last of
+ * 3. Notify level object (for Level 4 star block logic)
+ * 4. Return number of rows cleared (scored by GameController::onBlockLocked)
  */
 int Player::lockCurrentBlock() {
-    if (!currentBlock) return 0;
-    
-    // Save block type BEFORE any changes
-    char lockedBlockType = currentBlock->type;
-    lastLockedPositions = currentBlock->getAbsoluteCells();
+    if (currentBlock.empty()) return 0;
     
-    theirBoard->lockBlock(*currentBlock);
-    int rowsCleared = theirBoard->clearFullRows();
+    if (journal) journal->locking(journalSlot, theirBoard, currentBlock, currentBlockLevel);
+    theirBoard.lockBlock(currentBlock, currentBlockLevel);
+    if (journal) journal->clearing(journalSlot, theirBoard);
+    int rowsCleared = theirBoard.clearFullRows(playerScore);
     
     if (levelObj) {
         levelObj->onBlockLocked(rowsCleared);
@@ -145,95 +158,43 @@ int Player::lockCurrentBlock() {
         }
     }
     
-    // Store for scoring check
-    lastLockedBlockType = lockedBlockType;
-    
     return rowsCleared;
 }
 
 // For Level 4
 void Player::dropStarBlock() {
-    StarBlock star;  // Starts at row 3, col 5 (center)
+    Block star = makeBlock('*');  // Starts at row 6, col 5 (center)
     
-    // Drop to bottom
-    while (theirBoard->canPlace(star)) {
-        star.moveDown();
+    // Drop to bottom; if the centre column is already filled at the spawn
+    // row, the star rests on top of it one row higher
+    if (theirBoard.canPlace(star)) {
+        theirBoard.dropToBottom(star);
+    } else {
+        star.moveUp();
     }
-    star.moveUp();
     
     // Lock it
-    theirBoard->lockBlock(star);
+    if (journal) journal->locking(journalSlot, theirBoard, star, playerLevel);
+    theirBoard.lockBlock(star, playerLevel);
     
     // Clear any full rows from star block
-    int clearedRows = theirBoard->clearFullRows();
+    if (journal) journal->clearing(journalSlot, theirBoard);
+    int clearedRows = theirBoard.clearFullRows(playerScore);
     if (clearedRows > 0) {
         updateScore(clearedRows);
     }
 }
 
-/*
- * checkAndScoreCompletedBlocks() - Check if the just-dropped block was completely cleared
- * 
- * Improved logic explanation
- * 
- * After lockCurrentBlock():
- * 1. lastLockedPositions contains the absolute positions where block cells were placed
- * 2. Block was locked into grid
- * 3. Full rows were cleared and cells shifted down
- * 
- * To check if block was completely cleared:
- * - We check if all positions where we placed the block now have the block's type char
- * - If they don't (either empty or different char from shifting), the cells were cleared
- * 
- * Note: This is a simplified check. A more accurate approach would track which rows
- * were cleared and verify all block cells were in those rows. The current approach
- * works because:
- * - If cells shifted into the position, they'll have different chars (wrong type)
- * - If position is now empty, the row was cleared
- * - We just need to verify none of the original block cells remain
- */
-void Player::checkAndScoreCompletedBlocks() {
-    if (lastLockedPositions.empty()) return;
-    
-    // Use saved block type instead of currentBlock->type
-    char blockType = lastLockedBlockType;
-    bool allCleared = true;
-    
-    for (const auto& pos : lastLockedPositions) {
-        char cellContent = theirBoard->getCell(pos.row, pos.col);
-        if (cellContent == blockType) {
-            allCleared = false;
-            break;
-        }
-    }
-    
-    if (allCleared) {
-        // Score = (level when block was generated + 1)²
-        int bonus = (currentBlockLevel + 1) * (currentBlockLevel + 1);
-        playerScore += bonus;
-    }
-    
-    lastLockedPositions.clear();
-}
-
-
 void Player::replaceCurrentBlock(char type) {
-    switch (type) {
-        case 'I': currentBlock = std::make_unique<IBlock>(); break;
-        case 'J': currentBlock = std::make_unique<JBlock>(); break;
-        case 'L': currentBlock = std::make_unique<LBlock>(); break;
-        case 'O': currentBlock = std::make_unique<OBlock>(); break;
-        case 'S': currentBlock = std::make_unique<SBlock>(); break;
-        case 'Z': currentBlock = std::make_unique<ZBlock>(); break;
-        case 'T': currentBlock = std::make_unique<TBlock>(); break;
-        default: break;
+    if (isTetromino(type)) {
+        currentBlock = makeBlock(type);
     }
     // Note: Don't update currentBlockLevel here - testing commands don't change the level tracking
 }
 
 bool Player::canPlaceCurrentBlock() const {
-    if (!currentBlock) return true;
-    return theirBoard->canPlace(*currentBlock);
+    if (currentBlock.empty()) return true;
+    return theirBoard.canPlace(currentBlock);
 }
 
 // Scoring for cleared rows: (level + rows)²
@@ -245,20 +206,18 @@ void Player::updateScore(int rows) {
 // Reset
 // FIX: Preserve sequence file on reset
 void Player::reset(int startLevel) {
-    delete theirBoard;
-    theirBoard = new Board();
+    if (journal) journal->resetting(journalSlot, theirBoard);
+    theirBoard.reset();
     
     playerLevel = startLevel;
     playerScore = 0;
     currentBlockLevel = 0;
     
-    currentBlock = nullptr;
-    nextBlock = nullptr;
+    currentBlock = Block{};
+    nextBlock = Block{};
     
     // FIX: Use stored sequence file
-    levelObj = makeLevel(startLevel, sequenceFile);
-    
-    lastLockedPositions.clear();
+    levelObj = enterLevel(startLevel);
     
     heavyEffect = false;
     blindEffect = false;
@@ -274,15 +233,8 @@ void Player::applyBlindEffect() {
 }
 
 void Player::applyForceEffect(char type) {
-    switch (type) {
-        case 'I': currentBlock = std::make_unique<IBlock>(); break;
-        case 'J': currentBlock = std::make_unique<JBlock>(); break;
-        case 'L': currentBlock = std::make_unique<LBlock>(); break;
-        case 'O': currentBlock = std::make_unique<OBlock>(); break;
-        case 'S': currentBlock = std::make_unique<SBlock>(); break;
-        case 'Z': currentBlock = std::make_unique<ZBlock>(); break;
-        case 'T': currentBlock = std::make_unique<TBlock>(); break;
-        default: break;
+    if (isTetromino(type)) {
+        currentBlock = makeBlock(type);
     }
 }
 
@@ -303,3 +255,46 @@ void Player::setRandom() {
         levelObj->setRandom();
     }
 }
+
+// Snapshots: level objects are kept once made (see levelFor) and norandom
+// files once read (see NoRandomFiles), so restoring only reads a file the
+// first time it reaches a level this player has not been at
+void Player::saveState(PlayerState& s) const {
+    saveScalars(s);
+    s.board = theirBoard;
+}
+
+void Player::restoreState(const PlayerState& s) {
+    theirBoard = s.board;
+    restoreScalars(s);
+}
+
+void Player::saveScalars(PlayerState& s) const {
+    s.score = playerScore;
+    s.level = playerLevel;
+    s.currentBlockLevel = currentBlockLevel;
+    s.heavy = heavyEffect;
+    s.blind = blindEffect;
+    s.current = currentBlock;
+    s.next = nextBlock;
+    s.rng = rng;
+    levelObj->saveState(s.levelState);
+}
+
+void Player::restoreScalars(const PlayerState& s) {
+    playerScore = s.score;
+    currentBlockLevel = s.currentBlockLevel;
+    heavyEffect = s.heavy;
+    blindEffect = s.blind;
+    currentBlock = s.current;
+    nextBlock = s.next;
+    rng = s.rng;
+    playerLevel = s.level;
+    levelObj = levelFor(s.level);
+    levelObj->restoreState(s.levelState);
+}
+
+void Player::setJournal(Journal* j, int slot) {
+    journal = j;
+    journalSlot = slot;
+}
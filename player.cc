@@ -1,27 +1,48 @@
 export module Player;
 
+import <array>;
+import <cstdint>;
 import <memory>;
 import <string>;
 import <vector>;
 import Board;
 import Block;
 import Level;
+import Random;
+import Journal;
+
+// Everything that changes as a player plays, for snapshots of a match. The
+// sequence file name is fixed for the player's lifetime and not included.
+// Plain fixed-size data throughout, so copying one is a memcpy.
+export struct PlayerState {
+    std::int32_t score = 0;
+    std::int32_t level = 0;
+    std::int32_t currentBlockLevel = 0;
+    bool heavy = false;
+    bool blind = false;
+    Block current;
+    Block next;
+    Rng rng;
+    Board board;
+    LevelState levelState;
+};
 
 export class Player {
     int playerScore;
     int playerLevel;
-    Board* theirBoard;
-    std::unique_ptr<Block> currentBlock;
-    std::unique_ptr<Block> nextBlock;
-    std::unique_ptr<Level> levelObj;
-    char lastLockedBlockType = ' ';
+    Board theirBoard;    // stored inline, so snapshots copy it like any other field
+    Block currentBlock;  // stored inline; empty() before the first spawn
+    Block nextBlock;
+    Rng rng;  // this player's piece stream; outlives every levelObj
+    // One object per level, made the first time the player reaches it and
+    // then kept, so changing level again (or restoring a snapshot at another
+    // level) does not allocate or reread files. levelObj is the current one.
+    std::array<std::unique_ptr<Level>, 5> levels;
+    Level* levelObj;
     
     // Track the level when current block was generated (for scoring)
     int currentBlockLevel;
     
-    // Store positions of current block after locking (before clearing rows)
-    std::vector<Position> lastLockedPositions;
-    
     // Effect flags
     bool heavyEffect;
     bool blindEffect;
@@ -29,11 +50,23 @@ export class Player {
     // Store sequence file for Level 0
     std::string sequenceFile;
 
+    // Undo history this player's board changes are reported to, if any
+    Journal* journal = nullptr;
+    int journalSlot = 0;
+
+    Level* levelFor(int level);
+    Level* enterLevel(int level);
+
 public:
     Player();
     // Add sequence file parameter
     Player(int startLevel, const std::string& seqFile = "");
     ~Player();
+    // The level objects point at rng, so a Player stays where it was made
+    Player(const Player&) = delete;
+    Player& operator=(const Player&) = delete;
+    Player(Player&&) = delete;
+    Player& operator=(Player&&) = delete;
     
     // Getters
     int getLevel() const;
@@ -46,9 +79,10 @@ public:
     
     // Setters
     void setLevel(int level);
+    void setRng(const Rng& stream);
     
     // Block generation
-    std::unique_ptr<Block> generateBlock();
+    Block generateBlock();
     void spawnInitialBlocks();
     void spawnNextBlock();
     
@@ -59,7 +93,6 @@ public:
     
     // Scoring
     void updateScore(int rows);
-    void checkAndScoreCompletedBlocks();
     
     // Reset
     void reset(int startLevel);
@@ -76,4 +109,14 @@ public:
 
     // For level 4
     void dropStarBlock();
+    
+    // Snapshots
+    void saveState(PlayerState& s) const;
+    void restoreState(const PlayerState& s);
+    // Everything but the board (s.board is left alone)
+    void saveScalars(PlayerState& s) const;
+    void restoreScalars(const PlayerState& s);
+
+    // Report board changes to `j` as player `slot` (0 or 1); null to stop
+    void setJournal(Journal* j, int slot);
 };
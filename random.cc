@@ -0,0 +1,63 @@
+export module Random;
+
+import <array>;
+import <cstdint>;
+
+// splitmix64 step: expands a 64-bit seed into well-mixed state words
+export constexpr std::uint64_t splitmix64(std::uint64_t& x) {
+    std::uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256** generator. Each player owns one, so piece sequences depend
+// only on the seed, never on how turns interleave or on other threads.
+export class Rng {
+    std::array<std::uint64_t, 4> s;
+
+    static constexpr std::uint64_t rotl(std::uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+public:
+    explicit Rng(std::uint64_t seedValue = 0) { seed(seedValue); }
+
+    // Seed of independent stream `id` of a match seed (e.g. one per player)
+    static constexpr std::uint64_t streamSeed(std::uint64_t matchSeed, std::uint64_t id) {
+        std::uint64_t x = matchSeed;
+        return splitmix64(x) ^ (id * 0xD1B54A32D192ED03ull);
+    }
+
+    static Rng stream(std::uint64_t matchSeed, std::uint64_t id) {
+        return Rng(streamSeed(matchSeed, id));
+    }
+
+    void seed(std::uint64_t seedValue) {
+        std::uint64_t x = seedValue;
+        for (auto& word : s) {
+            word = splitmix64(x);
+        }
+    }
+
+    // Raw generator state, for snapshots
+    const std::array<std::uint64_t, 4>& state() const { return s; }
+    void setState(const std::array<std::uint64_t, 4>& state) { s = state; }
+
+    std::uint64_t next() {
+        std::uint64_t result = rotl(s[1] * 5, 7) * 9;
+        std::uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // Uniform integer in [0, n), by multiply-shift on the top 32 bits
+    int below(int n) {
+        return static_cast<int>(((next() >> 32) * static_cast<std::uint64_t>(n)) >> 32);
+    }
+};
@@ -0,0 +1,609 @@
+export module Replay;
+
+import Command;
+import Random;
+import Board;
+import Block;
+import Level;
+import Player;
+import MatchState;
+import <algorithm>;
+import <array>;
+import <cstdint>;
+import <fstream>;
+import <string>;
+import <string_view>;
+import <vector>;
+
+// Binary match recordings.
+//
+// Layout (all integers are LEB128 varints unless noted; signed values are
+// zigzag-encoded first):
+//   "BQRP" version seed
+//   playerSeed1 playerSeed2                   (8 bytes each, little-endian)
+//   startLevel
+//   2 x { name length, name bytes, content hash (8 bytes) }   sequence files
+//   records...
+//   0 score1 score2 hiScore commands         end record with the final result
+//   index                                    keyframe index
+//   indexOffset (8 bytes) "BQIX"             footer
+//
+// A record starts with a tag. Commands use (opcode << 1) | bit, where the
+// bit says a repeat count follows (otherwise it is 1). Replace is followed
+// by the block letter; NoRandom by its file name and content hash. Special
+// action choices use SpecialTag followed by a SpecialChoice byte, plus the
+// block letter for Force. Sequence commands are not recorded: the commands
+// they run are, so a replay does not need the sequence files.
+//
+// Every KeyframeInterval commands (starting before the first) a keyframe
+// record holds the whole MatchState: KeyframeTag, the number of commands
+// before it, its length (4 bytes) and the encoded state. The index lists
+// the total command count and, per keyframe, its command number and byte
+// offset (both delta-encoded), so a reader can seek to any command by
+// restoring the keyframe at or before it and replaying the rest.
+//
+// Undo and Redo commands are always followed by a keyframe holding the
+// state they led to: a replay restores it instead of running them, since
+// it has no undo history of its own.
+
+// Version 3 keyframes carry block identities. Older recordings are not
+// read: they were scored by an inexact rule and would not verify.
+export inline constexpr std::uint32_t ReplayVersion = 3;
+// Commands between keyframes: bounds the replay work of a seek to a few
+// hundred commands, for about 20% more file than no keyframes at all
+export inline constexpr long long KeyframeInterval = 512;
+
+// Which special action was chosen, reduced to what affects the game
+export enum class SpecialChoice : std::uint8_t {
+    None,    // input ended before a choice was read
+    Blind,
+    Heavy,
+    Force,   // with the forced block letter
+    Other    // anything that applied no effect
+};
+
+export struct ReplayHeader {
+    std::uint32_t version = ReplayVersion;
+    int seed = 0;
+    std::array<std::uint64_t, 2> playerSeeds{};
+    int startLevel = 0;
+    std::array<std::string, 2> sequenceFiles;
+    std::array<std::uint64_t, 2> sequenceHashes{};
+};
+
+export struct ReplayCommand {
+    Opcode op = Opcode::Invalid;
+    int repeat = 1;
+    char block = ' ';          // Replace
+    std::string file;          // NoRandom
+    std::uint64_t fileHash = 0;
+};
+
+export struct MatchResult {
+    int score1 = 0, score2 = 0, hiScore = 0;
+    long long commands = 0;
+};
+
+inline constexpr std::uint8_t Magic[4] = {'B', 'Q', 'R', 'P'};
+inline constexpr std::uint64_t EndTag = 0;
+inline constexpr std::uint64_t SpecialTag = 0x40;
+inline constexpr std::uint64_t KeyframeTag = 0x42;
+inline constexpr std::uint8_t IndexMagic[4] = {'B', 'Q', 'I', 'X'};
+
+// A keyframe in the index: commands before it and its byte offset
+struct KeyframeEntry {
+    long long move;
+    std::size_t offset;
+};
+
+// FNV-1a over a file's bytes; 0 if it cannot be read
+export std::uint64_t hashFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return 0;
+    std::uint64_t h = 0xCBF29CE484222325ull;
+    char buf[4096];
+    while (in.read(buf, sizeof buf) || in.gcount() > 0) {
+        for (std::streamsize i = 0; i < in.gcount(); ++i) {
+            h = (h ^ static_cast<unsigned char>(buf[i])) * 0x100000001B3ull;
+        }
+    }
+    return h;
+}
+
+// Collects a match in memory and writes it out when the match ends
+export class ReplayWriter {
+    std::string path;
+    std::vector<std::uint8_t> out;
+    long long moves = 0;                 // commands recorded so far
+    std::vector<KeyframeEntry> index;
+
+    void varint(std::uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<std::uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<std::uint8_t>(v));
+    }
+    void signedVarint(std::int64_t v) {
+        varint((static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63));
+    }
+    void fixed64(std::uint64_t v) {
+        for (int i = 0; i < 8; ++i) out.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+    }
+    void bytes(std::string_view s) {
+        varint(s.size());
+        out.insert(out.end(), s.begin(), s.end());
+    }
+
+    void block(const Block& b) {
+        out.push_back(static_cast<std::uint8_t>(b.type));
+        out.push_back(b.orientation);
+        signedVarint(b.row);
+        signedVarint(b.col);
+    }
+
+    // Rows as occupancy masks, followed by their filled cells: the letter
+    // and block id + 1 (0 for none), plus the block's level at the first
+    // cell of each block
+    void board(const Board& b) {
+        varint(static_cast<std::uint64_t>(b.numRows()));
+        varint(static_cast<std::uint64_t>(b.numCols()));
+        std::array<bool, Board::MaxBlocks> seen{};
+        for (int r = 0; r < b.numRows(); ++r) {
+            std::uint16_t mask = b.rowMask(r);
+            varint(mask);
+            for (int c = 0; c < b.numCols(); ++c) {
+                if (!(mask & (1u << c))) continue;
+                Board::CellRecord cell = b.cellRecord(r, c);
+                out.push_back(static_cast<std::uint8_t>(cell.symbol));
+                if (cell.block == Board::NoBlock) {
+                    varint(0);
+                    continue;
+                }
+                varint(cell.block + 1u);
+                if (!seen[cell.block]) out.push_back(cell.level);
+                seen[cell.block] = true;
+            }
+        }
+    }
+
+    void player(const PlayerState& p) {
+        signedVarint(p.score);
+        signedVarint(p.level);
+        signedVarint(p.currentBlockLevel);
+        out.push_back(static_cast<std::uint8_t>((p.heavy ? 1 : 0) | (p.blind ? 2 : 0)));
+        block(p.current);
+        block(p.next);
+        for (std::uint64_t word : p.rng.state()) fixed64(word);
+        board(p.board);
+
+        const LevelState& l = p.levelState;
+        varint(l.fileIndex);
+        signedVarint(l.blocksSinceClear);
+        out.push_back(static_cast<std::uint8_t>((l.starPending ? 1 : 0) | (l.noRandom ? 2 : 0)));
+        if (l.noRandom) bytes(l.file());
+    }
+
+public:
+    ReplayWriter(std::string path, int seed, int startLevel,
+                 const std::string& sequenceFile1, const std::string& sequenceFile2)
+        : path{std::move(path)} {
+        out.reserve(64 * 1024);
+        out.insert(out.end(), Magic, Magic + 4);
+        varint(ReplayVersion);
+        signedVarint(seed);
+        fixed64(Rng::streamSeed(static_cast<std::uint64_t>(seed), 1));
+        fixed64(Rng::streamSeed(static_cast<std::uint64_t>(seed), 2));
+        varint(static_cast<std::uint64_t>(startLevel));
+        for (const std::string* f : {&sequenceFile1, &sequenceFile2}) {
+            bytes(*f);
+            fixed64(hashFile(*f));
+        }
+    }
+
+    // Is a keyframe due before the next command?
+    bool wantsKeyframe() const {
+        return moves % KeyframeInterval == 0 && (index.empty() || index.back().move != moves);
+    }
+
+    // The state before the next command
+    void keyframe(const MatchState& s) {
+        index.push_back(KeyframeEntry{moves, out.size()});
+        varint(KeyframeTag);
+        varint(static_cast<std::uint64_t>(moves));
+
+        std::size_t lengthAt = out.size();
+        out.resize(out.size() + 4);
+        varint(static_cast<std::uint64_t>(s.current));
+        signedVarint(s.hiScore);
+        out.push_back(s.gameOver ? 1 : 0);
+        varint(static_cast<std::uint64_t>(s.commandsExecuted));
+        player(s.players[0]);
+        player(s.players[1]);
+
+        std::size_t length = out.size() - lengthAt - 4;
+        for (int i = 0; i < 4; ++i) out[lengthAt + i] = static_cast<std::uint8_t>(length >> (8 * i));
+    }
+
+    // One executed instruction; file is the NoRandom argument
+    void command(const Instruction& ins, const std::string& file) {
+        ++moves;
+        std::uint64_t op = static_cast<std::uint64_t>(ins.op);
+        if (ins.repeat == 1) {
+            varint(op << 1);
+        } else {
+            varint((op << 1) | 1);
+            varint(static_cast<std::uint64_t>(ins.repeat));
+        }
+        if (ins.op == Opcode::Replace) {
+            out.push_back(static_cast<std::uint8_t>(ins.block));
+        } else if (ins.op == Opcode::NoRandom) {
+            bytes(file);
+            fixed64(hashFile(file));
+        }
+    }
+
+    // The choice read by triggerSpecialAction (chosen is false at end of input)
+    void special(bool chosen, std::string_view action) {
+        varint(SpecialTag);
+        if (!chosen) {
+            out.push_back(static_cast<std::uint8_t>(SpecialChoice::None));
+        } else if (action == "blind") {
+            out.push_back(static_cast<std::uint8_t>(SpecialChoice::Blind));
+        } else if (action == "heavy") {
+            out.push_back(static_cast<std::uint8_t>(SpecialChoice::Heavy));
+        } else if (action.find("force") == 0 && action.length() >= 7) {
+            out.push_back(static_cast<std::uint8_t>(SpecialChoice::Force));
+            out.push_back(static_cast<std::uint8_t>(action[6]));
+        } else {
+            out.push_back(static_cast<std::uint8_t>(SpecialChoice::Other));
+        }
+    }
+
+    // Append the final result and write the file (see writeFileAtomic);
+    // false if it cannot be written
+    bool finish(const MatchResult& result) {
+        varint(EndTag);
+        signedVarint(result.score1);
+        signedVarint(result.score2);
+        signedVarint(result.hiScore);
+        varint(static_cast<std::uint64_t>(result.commands));
+
+        std::size_t indexOffset = out.size();
+        varint(static_cast<std::uint64_t>(moves));
+        varint(index.size());
+        KeyframeEntry prev{0, 0};
+        for (const KeyframeEntry& k : index) {
+            varint(static_cast<std::uint64_t>(k.move - prev.move));
+            varint(k.offset - prev.offset);
+            prev = k;
+        }
+        fixed64(indexOffset);
+        out.insert(out.end(), IndexMagic, IndexMagic + 4);
+
+        return writeFileAtomic(path, out.data(), out.size());
+    }
+
+    std::size_t size() const { return out.size(); }
+};
+
+// Reads a recording back record by record
+export class ReplayReader {
+    std::vector<std::uint8_t> data;
+    std::size_t pos = 0;
+    std::size_t bodyStart = 0;   // first record
+    ReplayHeader head;
+    MatchResult result;
+    bool ended = false;
+    long long moves = 0;         // commands read so far
+    long long totalMoves = -1;   // from the index; -1 without one
+    std::vector<KeyframeEntry> index;
+    std::string err;
+    std::string forced;  // "force X" handed out by nextSpecial
+
+    bool fail(const std::string& what) {
+        if (err.empty()) err = what;
+        return false;
+    }
+
+    bool varint(std::uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= data.size()) return fail("truncated replay");
+            std::uint8_t b = data[pos++];
+            v |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return fail("malformed varint");
+    }
+    template <typename T>
+    bool signedVarint(T& v) {
+        std::uint64_t u;
+        if (!varint(u)) return false;
+        v = static_cast<T>(static_cast<std::int64_t>(u >> 1) ^ -static_cast<std::int64_t>(u & 1));
+        return true;
+    }
+    bool fixed64(std::uint64_t& v) {
+        if (data.size() - pos < 8) return fail("truncated replay");
+        v = 0;
+        for (int i = 0; i < 8; ++i) v |= static_cast<std::uint64_t>(data[pos++]) << (8 * i);
+        return true;
+    }
+    bool byte(std::uint8_t& b) {
+        if (pos >= data.size()) return fail("truncated replay");
+        b = data[pos++];
+        return true;
+    }
+    bool bytes(std::string& s) {
+        std::uint64_t n;
+        if (!varint(n)) return false;
+        if (data.size() - pos < n) return fail("truncated replay");
+        s.assign(reinterpret_cast<const char*>(data.data() + pos), static_cast<std::size_t>(n));
+        pos += static_cast<std::size_t>(n);
+        return true;
+    }
+    bool fixed32(std::uint32_t& v) {
+        if (data.size() - pos < 4) return fail("truncated replay");
+        v = 0;
+        for (int i = 0; i < 4; ++i) v |= static_cast<std::uint32_t>(data[pos++]) << (8 * i);
+        return true;
+    }
+
+    bool block(Block& b) {
+        std::uint8_t type, orientation;
+        if (!byte(type) || !byte(orientation) || !signedVarint(b.row) || !signedVarint(b.col)) {
+            return false;
+        }
+        if (orientation > 3) return fail("malformed keyframe");
+        b.type = static_cast<char>(type);
+        b.orientation = orientation;
+        return true;
+    }
+
+    bool board(Board& b) {
+        std::uint64_t rows, cols;
+        if (!varint(rows) || !varint(cols)) return false;
+        if (rows < 1 || rows > Board::MaxRows || cols < 1 || cols > Board::MaxCols) {
+            return fail("malformed keyframe");
+        }
+        b = Board(static_cast<int>(rows), static_cast<int>(cols));
+        std::array<std::int16_t, Board::MaxBlocks> levels;
+        levels.fill(-1);
+        for (int r = 0; r < static_cast<int>(rows); ++r) {
+            std::uint64_t mask;
+            if (!varint(mask)) return false;
+            for (int c = 0; c < static_cast<int>(cols); ++c) {
+                if (!(mask & (1u << c))) continue;
+                Board::CellRecord cell;
+                std::uint8_t type;
+                std::uint64_t id;
+                if (!byte(type) || !varint(id)) return false;
+                if (type == ' ' || id > Board::MaxBlocks) return fail("malformed keyframe");
+                cell.symbol = static_cast<char>(type);
+                if (id > 0) {
+                    cell.block = static_cast<std::uint16_t>(id - 1);
+                    if (levels[cell.block] < 0) {
+                        std::uint8_t level;
+                        if (!byte(level)) return false;
+                        levels[cell.block] = level;
+                    }
+                    cell.level = static_cast<std::uint8_t>(levels[cell.block]);
+                }
+                b.restoreCell(r, c, cell);
+            }
+        }
+        return true;
+    }
+
+    bool player(PlayerState& p) {
+        std::uint8_t flags;
+        if (!signedVarint(p.score) || !signedVarint(p.level) ||
+            !signedVarint(p.currentBlockLevel) || !byte(flags) ||
+            !block(p.current) || !block(p.next)) {
+            return false;
+        }
+        if (p.level < 0 || p.level > 4) return fail("malformed keyframe");
+        p.heavy = flags & 1;
+        p.blind = flags & 2;
+        std::array<std::uint64_t, 4> rng;
+        for (std::uint64_t& word : rng) {
+            if (!fixed64(word)) return false;
+        }
+        p.rng.setState(rng);
+        if (!board(p.board)) return false;
+
+        LevelState& l = p.levelState;
+        std::uint64_t fileIndex;
+        if (!varint(fileIndex) || !signedVarint(l.blocksSinceClear) || !byte(flags)) return false;
+        l.fileIndex = static_cast<std::uint32_t>(fileIndex);
+        l.starPending = flags & 1;
+        l.noRandom = flags & 2;
+        l.noRandomFile.fill('\0');
+        if (!l.noRandom) return true;
+        std::string file;
+        if (!bytes(file)) return false;
+        return l.setFile(file) || fail("malformed keyframe");
+    }
+
+    std::vector<KeyframeEntry>::const_iterator lastKeyframe(long long move) const {
+        auto it = std::upper_bound(index.begin(), index.end(), move,
+                                   [](long long m, const KeyframeEntry& k) { return m < k.move; });
+        return it == index.begin() ? index.end() : it - 1;
+    }
+
+    // Keyframe index from the footer, if the file has one
+    bool readIndex() {
+        if (data.size() - bodyStart < 12 ||
+            !std::equal(IndexMagic, IndexMagic + 4, data.end() - 4)) {
+            return true;  // no index
+        }
+        pos = data.size() - 12;
+        std::uint64_t offset, total, count;
+        if (!fixed64(offset)) return false;
+        if (offset < bodyStart || offset >= data.size() - 12) return fail("malformed index");
+        pos = static_cast<std::size_t>(offset);
+        if (!varint(total) || !varint(count)) return false;
+        totalMoves = static_cast<long long>(total);
+        KeyframeEntry k{0, 0};
+        for (std::uint64_t i = 0; i < count; ++i) {
+            std::uint64_t dm, doff;
+            if (!varint(dm) || !varint(doff)) return false;
+            k.move += static_cast<long long>(dm);
+            k.offset += static_cast<std::size_t>(doff);
+            if (k.offset < bodyStart || k.offset >= offset) return fail("malformed index");
+            index.push_back(k);
+        }
+        pos = bodyStart;
+        return true;
+    }
+
+public:
+    // Load a recording and read its header
+    bool open(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return fail("could not open " + path);
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+        if (data.size() < 4 || !std::equal(Magic, Magic + 4, data.begin())) {
+            return fail(path + " is not a replay");
+        }
+        pos = 4;
+        std::uint64_t version, level;
+        if (!varint(version)) return false;
+        if (version != ReplayVersion) {
+            return fail("unsupported replay version " + std::to_string(version));
+        }
+        head.version = static_cast<std::uint32_t>(version);
+        if (!signedVarint(head.seed) || !fixed64(head.playerSeeds[0]) ||
+            !fixed64(head.playerSeeds[1]) || !varint(level)) {
+            return false;
+        }
+        head.startLevel = static_cast<int>(level);
+        for (int i = 0; i < 2; ++i) {
+            if (!bytes(head.sequenceFiles[i]) || !fixed64(head.sequenceHashes[i])) return false;
+        }
+        bodyStart = pos;
+        return readIndex();
+    }
+
+    const ReplayHeader& header() const { return head; }
+
+    // Next command; false at the end record or on error (see error())
+    bool nextCommand(ReplayCommand& cmd) {
+        if (ended) return false;
+        std::uint64_t tag;
+        if (!varint(tag)) return false;
+        while (tag == KeyframeTag) {
+            // Only needed when seeking
+            std::uint64_t move;
+            std::uint32_t length;
+            if (!varint(move) || !fixed32(length)) return false;
+            if (data.size() - pos < length) return fail("truncated replay");
+            pos += length;
+            if (!varint(tag)) return false;
+        }
+        if (tag == EndTag) {
+            std::uint64_t commands = 0;
+            ended = signedVarint(result.score1) && signedVarint(result.score2) &&
+                    signedVarint(result.hiScore) && varint(commands);
+            result.commands = static_cast<long long>(commands);
+            return false;
+        }
+        if (tag == SpecialTag) return fail("special action choice without a special action");
+
+        std::uint64_t op = tag >> 1;
+        if (op == 0 || op > static_cast<std::uint64_t>(Opcode::Branch)) return fail("unknown opcode");
+        cmd.op = static_cast<Opcode>(op);
+        cmd.repeat = 1;
+        if (tag & 1) {
+            std::uint64_t repeat;
+            if (!varint(repeat)) return false;
+            cmd.repeat = static_cast<int>(repeat);
+        }
+        if (cmd.op == Opcode::Replace) {
+            std::uint8_t b;
+            if (!byte(b)) return false;
+            cmd.block = static_cast<char>(b);
+        } else if (cmd.op == Opcode::NoRandom) {
+            if (!bytes(cmd.file) || !fixed64(cmd.fileHash)) return false;
+        }
+        ++moves;
+        return true;
+    }
+
+    // Commands read so far
+    long long position() const { return moves; }
+    // Commands in the whole recording, or -1 if it has no index
+    long long length() const { return totalMoves; }
+
+    // Back to the first command
+    void rewind() {
+        pos = bodyStart;
+        moves = 0;
+        ended = false;
+    }
+
+    // Command number of the last keyframe at or before command `move`, or
+    // -1 if there is none
+    long long keyframeBefore(long long move) const {
+        auto it = lastKeyframe(move);
+        return it == index.end() ? -1 : it->move;
+    }
+
+    // Move to the last keyframe at or before command `move` and read its
+    // state; false (leaving the position alone) if there is none
+    bool seekKeyframe(long long move, MatchState& s) {
+        auto it = lastKeyframe(move);
+        if (it == index.end()) return false;
+
+        std::size_t saved = pos;
+        pos = it->offset;
+        std::uint64_t tag, at, current, commands;
+        std::uint32_t length;
+        std::uint8_t gameOver;
+        if (!varint(tag) || tag != KeyframeTag || !varint(at) || !fixed32(length) ||
+            !varint(current) || !signedVarint(s.hiScore) || !byte(gameOver) ||
+            !varint(commands) || !player(s.players[0]) || !player(s.players[1])) {
+            pos = saved;
+            return fail("malformed keyframe");
+        }
+        s.current = current ? 1 : 0;
+        s.gameOver = gameOver != 0;
+        s.commandsExecuted = static_cast<long long>(commands);
+        moves = static_cast<long long>(at);
+        ended = false;
+        return true;
+    }
+
+    // The special action choice, as triggerSpecialAction would have read it;
+    // false if input had ended (or on error)
+    bool nextSpecial(std::string_view& action) {
+        std::uint64_t tag;
+        std::uint8_t choice;
+        if (!varint(tag)) return false;
+        if (tag != SpecialTag) return fail("missing special action choice");
+        if (!byte(choice)) return false;
+
+        switch (static_cast<SpecialChoice>(choice)) {
+            case SpecialChoice::None: return false;
+            case SpecialChoice::Blind: action = "blind"; return true;
+            case SpecialChoice::Heavy: action = "heavy"; return true;
+            case SpecialChoice::Force: {
+                std::uint8_t b;
+                if (!byte(b)) return false;
+                forced = "force ";
+                forced += static_cast<char>(b);
+                action = forced;
+                return true;
+            }
+            case SpecialChoice::Other: action = "?"; return true;
+        }
+        return fail("unknown special action choice");
+    }
+
+    // The recorded final result, once nextCommand has reached the end record
+    bool atEnd() const { return ended; }
+    const MatchResult& recordedResult() const { return result; }
+
+    const std::string& error() const { return err; }
+};
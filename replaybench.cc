@@ -0,0 +1,197 @@
+// End-to-end replay benchmark: feeds recorded command corpora line by line
+// through GameController::processCommand, once with a NullDisplay and once
+// with a TextDisplay writing to /dev/null, and checks every final score
+// against the values recorded next to the corpus.
+//
+// Usage: biquadris-replay-bench [manifest] [-repeat N]
+//
+// Each manifest line names a corpus and the result it must reproduce:
+//   <corpus file> <seed> <start level> <score 1> <score 2> <hi score> <commands>
+// Results are printed one JSON object per line; the exit status is non-zero
+// if any replay diverges from its recorded result.
+
+import GameController;
+import CommandInterpreter;
+import Player;
+import IDisplay;
+import NullDisplay;
+import TextDisplay;
+import <iostream>;
+import <fstream>;
+import <sstream>;
+import <string>;
+import <string_view>;
+import <vector>;
+import <chrono>;
+import <sys/resource.h>;
+
+using namespace std;
+
+// Forwards to another display, counting frames drawn
+class CountingDisplay : public IDisplay {
+    IDisplay& inner;
+
+public:
+    long long renders = 0;
+
+    explicit CountingDisplay(IDisplay& inner) : inner{inner} {}
+
+    void message(const string& s) override { inner.message(s); }
+    void render(const Frame& frame) override {
+        ++renders;
+        inner.render(frame);
+    }
+    bool wantsMessages() const override { return inner.wantsMessages(); }
+};
+
+struct CorpusEntry {
+    string file;
+    int seed, startLevel;
+    int score1, score2, hiScore;
+    long long commands;
+    string text;  // whole corpus, loaded up front so file IO is not timed
+};
+
+struct ReplayResult {
+    int score1, score2, hiScore;
+    long long commands, renders;
+    double seconds;
+};
+
+// Replay one corpus the way GameController::run would, stopping at game over
+static ReplayResult replay(const CorpusEntry& e, IDisplay& inner) {
+    Player p1(e.startLevel, "biquadris_sequence1.txt");
+    Player p2(e.startLevel, "biquadris_sequence2.txt");
+    CommandInterpreter ci(e.text);
+    CountingDisplay display(inner);
+
+    auto start = chrono::steady_clock::now();
+    GameController gc(&p1, &p2, &ci, e.seed, &display);
+    gc.startNewGame(e.startLevel);
+    Frame frame;
+    frame.capture(p1, p2);
+    display.render(frame);
+
+    string_view line;
+    while (!gc.isGameOver() && ci.readLine(line)) {
+        gc.processCommand(line);
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    return ReplayResult{p1.getScore(), p2.getScore(), gc.getHiScore(),
+                        gc.getCommandsExecuted(), display.renders, secs};
+}
+
+static long peakRssKb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;  // kilobytes on Linux
+}
+
+// "replays/corpus-a.txt" -> "corpus-a"
+static string corpusName(const string& path) {
+    size_t slash = path.find_last_of('/');
+    string name = (slash == string::npos) ? path : path.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    return (dot == string::npos) ? name : name.substr(0, dot);
+}
+
+static bool loadManifest(const string& path, vector<CorpusEntry>& entries) {
+    ifstream manifest(path);
+    if (!manifest) {
+        cerr << "replay-bench: cannot open manifest " << path << endl;
+        return false;
+    }
+
+    string line;
+    while (getline(manifest, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        CorpusEntry e;
+        istringstream fields(line);
+        if (!(fields >> e.file >> e.seed >> e.startLevel >> e.score1 >> e.score2
+                     >> e.hiScore >> e.commands)) {
+            cerr << "replay-bench: bad manifest line: " << line << endl;
+            return false;
+        }
+
+        ifstream corpus(e.file);
+        if (!corpus) {
+            cerr << "replay-bench: cannot open corpus " << e.file << endl;
+            return false;
+        }
+        stringstream text;
+        text << corpus.rdbuf();
+        e.text = text.str();
+        entries.push_back(e);
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    string manifestPath = "replays/expected.txt";
+    int repeat = 1;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-repeat" && i + 1 < argc) {
+            repeat = stoi(argv[++i]);
+        } else {
+            manifestPath = arg;
+        }
+    }
+
+    vector<CorpusEntry> entries;
+    if (!loadManifest(manifestPath, entries)) return 1;
+
+    // TextDisplay draws to cout; point cout at /dev/null while replaying
+    ofstream devNull("/dev/null");
+    NullDisplay nullDisplay;
+    TextDisplay textDisplay;
+    struct Mode {
+        string name;
+        IDisplay& display;
+        bool toDevNull;
+    };
+    vector<Mode> modes = {{"null", nullDisplay, false}, {"text", textDisplay, true}};
+
+    bool allOk = true;
+    for (const Mode& mode : modes) {
+        for (const CorpusEntry& e : entries) {
+            long long commands = 0, renders = 0;
+            double secs = 0;
+            bool ok = true;
+
+            for (int r = 0; r < repeat; ++r) {
+                streambuf* saved = cout.rdbuf();
+                if (mode.toDevNull) cout.rdbuf(devNull.rdbuf());
+                ReplayResult res = replay(e, mode.display);
+                cout.rdbuf(saved);
+
+                commands += res.commands;
+                renders += res.renders;
+                secs += res.seconds;
+                if (res.score1 != e.score1 || res.score2 != e.score2 ||
+                    res.hiScore != e.hiScore || res.commands != e.commands) {
+                    ok = false;
+                    cerr << "replay-bench: " << e.file << " (" << mode.name
+                         << ") diverged: got " << res.score1 << ' ' << res.score2 << ' '
+                         << res.hiScore << ' ' << res.commands << ", expected "
+                         << e.score1 << ' ' << e.score2 << ' ' << e.hiScore << ' '
+                         << e.commands << endl;
+                }
+            }
+            allOk = allOk && ok;
+            if (secs <= 0) secs = 1e-9;
+
+            cout << "{\"name\": \"replay." << corpusName(e.file) << "." << mode.name << "\""
+                 << ", \"commands\": " << commands
+                 << ", \"renders\": " << renders
+                 << ", \"seconds\": " << secs
+                 << ", \"commands_per_sec\": " << commands / secs
+                 << ", \"renders_per_sec\": " << renders / secs
+                 << ", \"scores_match\": " << (ok ? "true" : "false") << "}" << endl;
+        }
+    }
+
+    cout << "{\"name\": \"replay.peak_rss\", \"kilobytes\": " << peakRssKb() << "}" << endl;
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+export module ReplaySession;
+
+import GameController;
+import CommandInterpreter;
+import Command;
+import Player;
+import NullDisplay;
+import MatchState;
+import Replay;
+import Random;
+import <iostream>;
+import <memory>;
+import <string>;
+import <string_view>;
+import <cstdint>;
+import <chrono>;
+
+using namespace std;
+
+// A recorded match loaded into a headless game that can be stepped through
+// and positioned at any command. Seeking restores the nearest keyframe at
+// or before the target and replays only the commands after it.
+export class ReplaySession {
+    ReplayReader replay;
+    unique_ptr<Player> p1, p2;
+    CommandInterpreter ci{string_view{}};
+    NullDisplay display;
+    unique_ptr<GameController> gc;
+    MatchState keyframe;  // reused by seek
+    string err;
+
+    bool fail(const string& what) {
+        if (err.empty()) err = what;
+        return false;
+    }
+
+    // A fresh game at the recorded start, before the first command
+    void startGame() {
+        const ReplayHeader& h = replay.header();
+        gc.reset();
+        p1 = make_unique<Player>(h.startLevel, h.sequenceFiles[0]);
+        p2 = make_unique<Player>(h.startLevel, h.sequenceFiles[1]);
+        gc = make_unique<GameController>(p1.get(), p2.get(), &ci, h.seed, &display);
+        gc->setRenderPolicy(RenderPolicy::FinalOnly);
+        gc->setReplaySource(&replay);
+        gc->startNewGame(h.startLevel);
+        replay.rewind();
+    }
+
+public:
+    // Load a recording, check it was made from the same inputs, and set up
+    // the game before its first command
+    bool open(const string& path) {
+        if (!replay.open(path)) return fail(replay.error());
+
+        const ReplayHeader& h = replay.header();
+        for (int i = 0; i < 2; ++i) {
+            if (Rng::streamSeed(static_cast<uint64_t>(h.seed), i + 1) != h.playerSeeds[i]) {
+                return fail("recorded with different random streams");
+            }
+            if (hashFile(h.sequenceFiles[i]) != h.sequenceHashes[i]) {
+                return fail("sequence file " + h.sequenceFiles[i] + " has changed");
+            }
+        }
+        startGame();
+        return true;
+    }
+
+    // Execute the next command; false at the end of the recording or on error
+    bool step() {
+        ReplayCommand cmd;
+        if (!replay.nextCommand(cmd)) return false;
+        if (cmd.op == Opcode::NoRandom && hashFile(cmd.file) != cmd.fileHash) {
+            return fail("norandom file " + cmd.file + " has changed");
+        }
+        if (cmd.op == Opcode::Undo || cmd.op == Opcode::Redo) {
+            // Recorded with the state they led to, in the keyframe that follows
+            if (replay.keyframeBefore(replay.position()) != replay.position()) {
+                return fail("missing keyframe after undo or redo");
+            }
+            if (!replay.seekKeyframe(replay.position(), keyframe)) return fail(replay.error());
+            gc->restore(keyframe);
+            return true;
+        }
+        gc->execute(ci.make(cmd.op, cmd.repeat, cmd.block, cmd.file));
+        return replay.error().empty() || fail(replay.error());
+    }
+
+    // Position the game after `move` commands (or at the end, if the
+    // recording is shorter); false on error
+    bool seek(long long move) {
+        long long at = replay.position();
+        long long k = replay.keyframeBefore(move);
+        if (move < at || k > at) {
+            // From the nearest keyframe (or the start), unless moving forward
+            // from where we are replays fewer commands
+            if (k < 0) {
+                startGame();
+            } else if (replay.seekKeyframe(move, keyframe)) {
+                gc->restore(keyframe);
+            } else {
+                return fail(replay.error());
+            }
+        }
+        while (replay.position() < move && step()) {}
+        return err.empty() && replay.error().empty();
+    }
+
+    // Run to the end of the recording
+    bool finish() {
+        while (step()) {}
+        return err.empty() && replay.atEnd();
+    }
+
+    long long position() const { return replay.position(); }
+    long long length() const { return replay.length(); }
+    bool atEnd() const { return replay.atEnd(); }
+    const MatchResult& recordedResult() const { return replay.recordedResult(); }
+
+    GameController& game() { return *gc; }
+    Player& player(int i) { return i == 0 ? *p1 : *p2; }
+
+    const string& error() const { return err.empty() ? replay.error() : err; }
+};
+
+// Re-execute a recorded match with no display, at full engine speed, and
+// check that it reaches the recorded final scores. Reports and returns false
+// if the recording cannot be read, was made from different inputs, or
+// diverges.
+export bool verifyReplay(const string& path, ostream& out) {
+    ReplaySession session;
+    if (!session.open(path)) {
+        out << "replay: " << session.error() << endl;
+        return false;
+    }
+
+    auto start = chrono::steady_clock::now();
+    bool finished = session.finish();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (!finished) {
+        out << "replay: " << (session.error().empty() ? "missing end record" : session.error()) << endl;
+        return false;
+    }
+
+    GameController& gc = session.game();
+    int score1 = session.player(0).getScore(), score2 = session.player(1).getScore();
+    const MatchResult& want = session.recordedResult();
+    bool match = score1 == want.score1 && score2 == want.score2 && gc.getHiScore() == want.hiScore;
+    out << "replay " << path << ": Player 1: " << score1 << ", Player 2: " << score2
+        << ", hi score " << gc.getHiScore() << ", " << gc.getCommandsExecuted()
+        << " commands in " << secs << " s: ";
+    if (match) {
+        out << "scores match" << endl;
+    } else {
+        out << "DIVERGED from recorded " << want.score1 << " / " << want.score2
+            << " (hi score " << want.hiScore << ")" << endl;
+    }
+    return match;
+}
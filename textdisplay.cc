@@ -6,108 +6,215 @@ import Block;
 import IDisplay;
 import <iostream>;
 import <string>;
+import <string_view>;
 import <vector>;
 
 using namespace std;
 
+// Draws both boards as text. Each frame is composed into a reused buffer and
+// written with one call. In ANSI mode only the parts of lines that changed
+// since the previous frame are rewritten, using cursor movement; messages
+// go in the area below the frame and are cleared by the first message after
+// the next frame. ANSI mode assumes the terminal is tall enough to hold the
+// frame and the messages of one turn.
 export class TextDisplay : public IDisplay{
+    bool ansi;
+
+    string frame;               // the frame being composed, '\n' after each line
+    vector<size_t> lineStart;   // offset of each line in frame, then frame.size()
+
+    // ANSI mode only
+    string shown;               // the frame currently on screen
+    vector<size_t> shownStart;
+    string out;                 // escape sequences for one update
+    int messageLines = 0;       // lines printed below the frame
+    bool clearMessages = false; // the next message starts a new turn
+    vector<string> early;       // messages from before the first frame
+
 public:
+    explicit TextDisplay(bool ansi = false) : ansi{ansi} {
+        frame.reserve(1024);
+        shown.reserve(1024);
+        out.reserve(1024);
+    }
+
     void message(const string& s) override {
+        if (ansi) {
+            if (shown.empty()) {
+                early.push_back(s);
+                return;
+            }
+            if (clearMessages) {
+                // Back to the top of the message area and clear below it
+                cout << "\x1b[" << lineCount(shownStart) + 1 << ";1H\x1b[J";
+                messageLines = 0;
+                clearMessages = false;
+            }
+            ++messageLines;
+        }
         cout << s << endl;
     }
-    void render(Player& p1, Player& p2) override {
-        Board& b1 = p1.getBoard();
-        Board& b2 = p2.getBoard();
-
-        // Copy grids to overlay current blocks
-        vector<vector<char>> grid1 = b1.getGrid();
-        vector<vector<char>> grid2 = b2.getGrid();
-
-        // Overlay current blocks
-        Block* curr1 = p1.getCurrentBlock();
-        if (curr1) {
-            for (const auto& pos : curr1->getAbsoluteCells()) {
-                if (pos.row >= 0 && pos.row < b1.numRows() &&
-                    pos.col >= 0 && pos.col < b1.numCols()) {
-                    grid1[pos.row][pos.col] = curr1->type;
-                }
+
+    void render(const Frame& f) override {
+        compose(f.players[0], f.players[1]);
+
+        if (!ansi) {
+            cout.write(frame.data(), static_cast<streamsize>(frame.size()));
+            cout.flush();
+            return;
+        }
+
+        out.clear();
+        int lines = lineCount(lineStart);
+        if (shown.empty() || lineCount(shownStart) != lines) {
+            // Full redraw from a cleared screen
+            out += "\x1b[H\x1b[2J";
+            out += frame;
+            messageLines = 0;
+        } else {
+            for (int i = 0; i < lines; ++i) {
+                string_view now = line(frame, lineStart, i);
+                string_view before = line(shown, shownStart, i);
+                if (now == before) continue;
+
+                // Rewrite from the first changed column to the end of the line
+                size_t col = 0;
+                while (col < now.size() && col < before.size() && now[col] == before[col]) ++col;
+                moveTo(i + 1, static_cast<int>(col) + 1);
+                out.append(now.substr(col));
+                out += "\x1b[K";
             }
         }
 
-        Block* curr2 = p2.getCurrentBlock();
-        if (curr2) {
-            for (const auto& pos : curr2->getAbsoluteCells()) {
-                if (pos.row >= 0 && pos.row < b2.numRows() &&
-                    pos.col >= 0 && pos.col < b2.numCols()) {
-                    grid2[pos.row][pos.col] = curr2->type;
+        // Park the cursor below the frame and this turn's messages
+        moveTo(lines + 1 + messageLines, 1);
+        cout.write(out.data(), static_cast<streamsize>(out.size()));
+        cout.flush();
+
+        shown.swap(frame);
+        shownStart.swap(lineStart);
+        clearMessages = true;
+
+        if (!early.empty()) {
+            vector<string> pending;
+            pending.swap(early);
+            for (const string& s : pending) message(s);
+        }
+    }
+
+private:
+    static int lineCount(const vector<size_t>& starts) {
+        return starts.empty() ? 0 : static_cast<int>(starts.size()) - 1;
+    }
+
+    // Line i of a composed frame, without its '\n'
+    static string_view line(const string& f, const vector<size_t>& starts, int i) {
+        return string_view(f).substr(starts[i], starts[i + 1] - starts[i] - 1);
+    }
+
+    void moveTo(int row, int col) {
+        out += "\x1b[";
+        out += to_string(row);
+        out += ';';
+        out += to_string(col);
+        out += 'H';
+    }
+
+    void endLine() {
+        frame += '\n';
+        lineStart.push_back(frame.size());
+    }
+
+    // Write one board row: the settled cells, the current block on top, and
+    // the blind effect's '?' patch over both
+    void appendRow(const PlayerFrame& p, int r) {
+        const Board& b = p.board;
+        size_t start = frame.size();
+        for (int c = 0; c < b.numCols(); ++c) {
+            frame += b.getCell(r, c);
+        }
+
+        const Block* curr = p.currentBlock();
+        if (curr) {
+            for (const auto& pos : curr->getAbsoluteCells()) {
+                if (pos.row == r && pos.col >= 0 && pos.col < b.numCols()) {
+                    frame[start + pos.col] = curr->type;
                 }
             }
         }
 
-        // Print header
-        cout << "Level:    " << p1.getLevel() << "    Level:    " << p2.getLevel() << endl;
-        cout << "Score:    " << p1.getScore() << "    Score:    " << p2.getScore() << endl;
-        cout << "-----------    -----------" << endl;
-
-        // Print boards (skip 3 reserve rows)
-        for (int r = 3; r < b1.numRows(); ++r) {
-            for (int c = 0; c < b1.numCols(); ++c) {
-		    if (p1.hasBlindEffect() && c>=2 && c<=8 && r>=6 && r <= 18){
-			    cout << "?";
-		    }
-		    else {
-		    	cout << grid1[r][c];
-		    }
-	    }
-            cout << "    ";
-            for (int c = 0; c < b2.numCols(); ++c){
-                    if (p2.hasBlindEffect() &&  c>=2 && c<=8 && r>=6 && r <= 18){
-                            cout << "?";
-                    }
-                    else {
-                        cout << grid2[r][c];
-                    }
-            }	   
-            
-	    cout << endl;
+        if (p.blind && r >= 6 && r <= 18) {
+            for (int c = 2; c <= 8 && c < b.numCols(); ++c) {
+                frame[start + c] = '?';
+            }
         }
+    }
 
-        cout << "-----------    -----------" << endl;
-        cout << "Next:          Next:" << endl;
+    void compose(const PlayerFrame& p1, const PlayerFrame& p2) {
+        frame.clear();
+        lineStart.clear();
+        lineStart.push_back(0);
 
-        // Print next blocks (simplified)
-        Block* n1 = p1.getNextBlock();
-        Block* n2 = p2.getNextBlock();
+        // Header
+        frame += "Level:    ";
+        frame += to_string(p1.level);
+        frame += "    Level:    ";
+        frame += to_string(p2.level);
+        endLine();
+        frame += "Score:    ";
+        frame += to_string(p1.score);
+        frame += "    Score:    ";
+        frame += to_string(p2.score);
+        endLine();
+        frame += "-----------    -----------";
+        endLine();
 
-        string n1r1, n1r2, n2r1, n2r2;
-        getBlockPattern(n1, n1r1, n1r2);
-        getBlockPattern(n2, n2r1, n2r2);
+        // Boards (skip 3 reserve rows)
+        int rows = p1.board.numRows();
+        for (int r = 3; r < rows; ++r) {
+            appendRow(p1, r);
+            frame += "    ";
+            appendRow(p2, r);
+            endLine();
+        }
 
-        while (n1r1.length() < 11) n1r1 += ' ';
-        while (n1r2.length() < 11) n1r2 += ' ';
+        frame += "-----------    -----------";
+        endLine();
+        frame += "Next:          Next:";
+        endLine();
 
-        cout << n1r1 << "    " << n2r1 << endl;
-        if (!n1r2.empty() || !n2r2.empty()) {
-            cout << n1r2 << "    " << n2r2 << endl;
+        // Next blocks, two preview rows each; player 1's are padded to the
+        // board width so player 2's line up
+        const char* n1[2];
+        const char* n2[2];
+        getBlockPattern(p1.nextBlock(), n1);
+        getBlockPattern(p2.nextBlock(), n2);
+        for (int i = 0; i < 2; ++i) {
+            size_t start = frame.size();
+            frame += n1[i];
+            while (frame.size() - start < 11) frame += ' ';
+            frame += "    ";
+            frame += n2[i];
+            endLine();
         }
 
-        cout << "~~~~~~~~~~~~~~~~~~~~~~~~~~" << endl;
+        frame += "~~~~~~~~~~~~~~~~~~~~~~~~~~";
+        endLine();
     }
 
-private:
-    void getBlockPattern(Block* b, string& r1, string& r2) {
-        r1 = ""; r2 = "";
+    void getBlockPattern(const Block* b, const char* rows[2]) {
+        rows[0] = ""; rows[1] = "";
         if (!b) return;
         switch (b->getSymbol()) {
-            case 'I': r1 = "IIII"; break;
-            case 'J': r1 = "J"; r2 = "JJJ"; break;
-            case 'L': r1 = "  L"; r2 = "LLL"; break;
-            case 'O': r1 = "OO"; r2 = "OO"; break;
-            case 'S': r1 = " SS"; r2 = "SS"; break;
-            case 'Z': r1 = "ZZ"; r2 = " ZZ"; break;
-            case 'T': r1 = "TTT"; r2 = " T"; break;
-            case '*': r1 = "*"; break;
-            default: r1 = "?"; break;
+            case 'I': rows[0] = "IIII"; break;
+            case 'J': rows[0] = "J"; rows[1] = "JJJ"; break;
+            case 'L': rows[0] = "  L"; rows[1] = "LLL"; break;
+            case 'O': rows[0] = "OO"; rows[1] = "OO"; break;
+            case 'S': rows[0] = " SS"; rows[1] = "SS"; break;
+            case 'Z': rows[0] = "ZZ"; rows[1] = " ZZ"; break;
+            case 'T': rows[0] = "TTT"; rows[1] = " T"; break;
+            case '*': rows[0] = "*"; break;
+            default: rows[0] = "?"; break;
         }
     }
 };
@@ -0,0 +1,125 @@
+export module WorkStealing;
+
+import <vector>;
+import <deque>;
+import <mutex>;
+import <condition_variable>;
+import <thread>;
+import <functional>;
+import <algorithm>;
+import <atomic>;
+import <exception>;
+
+// One worker's queue of job indices. The owner takes from the front,
+// thieves take from the back.
+struct WorkerQueue {
+    std::mutex m;
+    std::deque<int> jobs;
+};
+
+// Runs job(i) for every i in [0, count) on `threads` worker threads.
+// Each worker starts with a contiguous slice of the indices; when its own
+// deque runs dry it steals the back half of another worker's deque.
+// onDone(i) runs on the calling thread, strictly in index order, as soon as
+// jobs 0..i have all finished, so output is identical for any thread count.
+// If a job or onDone throws, no further jobs start, the workers are joined
+// and the first exception is rethrown here; onDone has then run for a
+// prefix of the indices only.
+export void runWorkStealing(int count, int threads,
+                            const std::function<void(int)>& job,
+                            const std::function<void(int)>& onDone) {
+    if (count <= 0) return;
+    threads = std::clamp(threads, 1, count);
+
+    std::vector<WorkerQueue> queues(threads);
+    for (int t = 0; t < threads; ++t) {
+        int lo = static_cast<int>(static_cast<long long>(count) * t / threads);
+        int hi = static_cast<int>(static_cast<long long>(count) * (t + 1) / threads);
+        for (int i = lo; i < hi; ++i) {
+            queues[t].jobs.push_back(i);
+        }
+    }
+
+    std::vector<char> done(count, 0);
+    std::mutex doneMutex;
+    std::condition_variable doneCv;
+    std::exception_ptr failure;     // the first exception thrown, under doneMutex
+    std::atomic<bool> stop{false};  // set once anything has thrown
+
+    auto takeOwn = [&](int self, int& idx) {
+        std::lock_guard<std::mutex> lock(queues[self].m);
+        if (queues[self].jobs.empty()) return false;
+        idx = queues[self].jobs.front();
+        queues[self].jobs.pop_front();
+        return true;
+    };
+
+    auto steal = [&](int self, int& idx) {
+        for (int k = 1; k < threads; ++k) {
+            WorkerQueue& victim = queues[(self + k) % threads];
+            std::deque<int> loot;
+            {
+                std::lock_guard<std::mutex> lock(victim.m);
+                size_t take = (victim.jobs.size() + 1) / 2;
+                if (take == 0) continue;
+                loot.assign(victim.jobs.end() - take, victim.jobs.end());
+                victim.jobs.erase(victim.jobs.end() - take, victim.jobs.end());
+            }
+            idx = loot.front();
+            loot.pop_front();
+            if (!loot.empty()) {
+                std::lock_guard<std::mutex> lock(queues[self].m);
+                queues[self].jobs.insert(queues[self].jobs.end(), loot.begin(), loot.end());
+            }
+            return true;
+        }
+        return false;
+    };
+
+    auto worker = [&](int self) {
+        int idx;
+        while (!stop && (takeOwn(self, idx) || steal(self, idx))) {
+            std::exception_ptr thrown;
+            try {
+                job(idx);
+            } catch (...) {
+                thrown = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                done[idx] = 1;
+                if (thrown && !failure) failure = thrown;
+            }
+            if (thrown) stop = true;
+            doneCv.notify_one();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back(worker, t);
+    }
+
+    // Report completed jobs in index order while the workers run
+    std::unique_lock<std::mutex> lock(doneMutex);
+    for (int next = 0; next < count; ++next) {
+        doneCv.wait(lock, [&] { return done[next] != 0 || failure; });
+        if (failure) break;
+        lock.unlock();
+        try {
+            onDone(next);
+        } catch (...) {
+            lock.lock();
+            if (!failure) failure = std::current_exception();
+            stop = true;
+            break;
+        }
+        lock.lock();
+    }
+    lock.unlock();
+
+    for (auto& t : pool) {
+        t.join();
+    }
+    if (failure) std::rethrow_exception(failure);
+}